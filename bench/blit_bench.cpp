@@ -0,0 +1,200 @@
+// Software sprite blitter against SDL's own software renderer - headless, draws into surfaces, needs the SDL2 library
+// Build & run (Linux):
+//	g++ -std=c++20 -O2 -DNDEBUG -Iinclude bench/blit_bench.cpp src/blit_batch.cpp src/jobs.cpp src/software_blit.cpp -lSDL2 -pthread -o blit_bench
+//	./blit_bench [results.json]
+// Every case draws the same sprites into a 1280x720 framebuffer, the time is per frame
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+#include <SDL/SDL.h>
+
+#include "blit_batch.h"
+#include "jobs.h"
+#include "software_blit.h"
+
+#define FRAMEBUFFER_WIDTH 1280
+#define FRAMEBUFFER_HEIGHT 720
+#define SHEET_SIZE 256
+#define SPRITE_SIZE 32
+
+struct bench_result
+{
+	const char* name;
+	const char* filter;
+	float scale;
+	size_t sprites;
+	size_t frames;
+	double total_ms;
+};
+
+struct sprite
+{
+	SDL_Rect src;
+	SDL_FRect dst;
+};
+
+static std::vector<bench_result> results;
+
+static double milliseconds_since(std::chrono::steady_clock::time_point start)
+{
+	using namespace std::chrono;
+	return duration<double, std::milli>(steady_clock::now() - start).count();
+}
+
+static void report(const char* name, blit_filter filter, float scale, size_t sprites, size_t frames, double total_ms)
+{
+	const char* filter_name = filter == BLIT_FILTER_NEAREST ? "nearest" : "bilinear";
+	results.push_back({ name, filter_name, scale, sprites, frames, total_ms });
+	printf("%-16s %-9s %6.2f %8zu %8zu %12.3f %12.3f\n", name, filter_name, scale, sprites, frames, total_ms, total_ms / frames);
+}
+
+// Soft edged circles, so the alpha blend has something to do
+static SDL_Surface* create_sheet()
+{
+	SDL_Surface* sheet = SDL_CreateRGBSurfaceWithFormat(0, SHEET_SIZE, SHEET_SIZE, 32, SDL_PIXELFORMAT_RGBA32);
+	for (int y = 0; y < SHEET_SIZE; y++) {
+		Uint8* row = (Uint8*)sheet->pixels + y * sheet->pitch;
+		for (int x = 0; x < SHEET_SIZE; x++) {
+			float dx = (x % SPRITE_SIZE) - SPRITE_SIZE * 0.5f + 0.5f;
+			float dy = (y % SPRITE_SIZE) - SPRITE_SIZE * 0.5f + 0.5f;
+			float edge = SPRITE_SIZE * 0.5f - SDL_sqrtf(dx * dx + dy * dy);
+			row[x * 4 + 0] = (Uint8)(x * 255 / SHEET_SIZE);
+			row[x * 4 + 1] = (Uint8)(y * 255 / SHEET_SIZE);
+			row[x * 4 + 2] = 160;
+			row[x * 4 + 3] = (Uint8)SDL_clamp(edge * 64.0f, 0.0f, 255.0f);
+		}
+	}
+	return sheet;
+}
+
+static std::vector<sprite> create_sprites(size_t count, float scale)
+{
+	std::vector<sprite> sprites(count);
+	srand(1);
+	int columns = SHEET_SIZE / SPRITE_SIZE;
+	for (auto& s : sprites) {
+		int index = rand() % (columns * columns);
+		s.src = { (index % columns) * SPRITE_SIZE, (index / columns) * SPRITE_SIZE, SPRITE_SIZE, SPRITE_SIZE };
+		float size = SPRITE_SIZE * scale;
+		// Whole pixel positions at scale 1, so the unscaled fast path is what gets measured there
+		float x = (float)(rand() % (FRAMEBUFFER_WIDTH + (int)size)) - size;
+		float y = (float)(rand() % (FRAMEBUFFER_HEIGHT + (int)size)) - size;
+		s.dst = { x, y, size, size };
+	}
+	return sprites;
+}
+
+static void bench_blit(const char* name, blit_simd simd, SDL_Surface* framebuffer, SDL_Surface* sheet, const std::vector<sprite>& sprites, blit_filter filter, float scale, size_t frames)
+{
+	software_blit::set_simd(simd);
+	if (software_blit::get_simd() != simd) {
+		printf("%-16s not supported by this CPU\n", name);
+		return;
+	}
+	SDL_Rect clip{ 0, 0, framebuffer->w, framebuffer->h };
+	auto start = std::chrono::steady_clock::now();
+	for (size_t frame = 0; frame < frames; frame++) {
+		SDL_FillRect(framebuffer, nullptr, 0);
+		for (const auto& s : sprites) {
+			software_blit::draw(framebuffer, clip, sheet, s.src, s.dst, { 255, 255, 255, 255 }, SDL_BLENDMODE_BLEND, filter);
+		}
+	}
+	report(name, filter, scale, sprites.size(), frames, milliseconds_since(start));
+}
+
+// Same blits with the best instruction set, split into tiles over every worker
+static void bench_tiled(SDL_Surface* framebuffer, SDL_Surface* sheet, const std::vector<sprite>& sprites, blit_filter filter, float scale, size_t frames)
+{
+	blit_batch batch;
+	auto start = std::chrono::steady_clock::now();
+	for (size_t frame = 0; frame < frames; frame++) {
+		SDL_FillRect(framebuffer, nullptr, 0);
+		for (const auto& s : sprites) {
+			batch.add(sheet, s.src, s.dst, { 255, 255, 255, 255 }, SDL_BLENDMODE_BLEND, filter);
+		}
+		batch.flush(framebuffer);
+	}
+	report("blit_tiled", filter, scale, sprites.size(), frames, milliseconds_since(start));
+}
+
+static void bench_sdl(SDL_Surface* framebuffer, SDL_Surface* sheet, const std::vector<sprite>& sprites, blit_filter filter, float scale, size_t frames)
+{
+	SDL_Renderer* renderer = SDL_CreateSoftwareRenderer(framebuffer);
+	SDL_Texture* texture = renderer != nullptr ? SDL_CreateTextureFromSurface(renderer, sheet) : nullptr;
+	if (texture == nullptr) {
+		printf("Could not create the SDL software renderer: %s\n", SDL_GetError());
+		SDL_DestroyRenderer(renderer);
+		return;
+	}
+	SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+	SDL_SetTextureScaleMode(texture, filter == BLIT_FILTER_NEAREST ? SDL_ScaleModeNearest : SDL_ScaleModeLinear);
+	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+	auto start = std::chrono::steady_clock::now();
+	for (size_t frame = 0; frame < frames; frame++) {
+		SDL_RenderClear(renderer);
+		for (const auto& s : sprites) {
+			SDL_RenderCopyF(renderer, texture, &s.src, &s.dst);
+		}
+		SDL_RenderFlush(renderer);
+	}
+	report("sdl_software", filter, scale, sprites.size(), frames, milliseconds_since(start));
+	SDL_DestroyTexture(texture);
+	SDL_DestroyRenderer(renderer);
+}
+
+static bool write_results(const char* path)
+{
+	FILE* file = fopen(path, "w");
+	if (file == nullptr) {
+		return false;
+	}
+	fprintf(file, "[\n");
+	for (size_t i = 0; i < results.size(); i++) {
+		const bench_result& r = results[i];
+		fprintf(file, "\t{ \"name\": \"%s\", \"filter\": \"%s\", \"scale\": %.2f, \"sprites\": %zu, \"frames\": %zu, \"total_ms\": %.3f, \"ms_per_frame\": %.4f }%s\n",
+			r.name, r.filter, r.scale, r.sprites, r.frames, r.total_ms, r.total_ms / r.frames, i + 1 < results.size() ? "," : "");
+	}
+	fprintf(file, "]\n");
+	fclose(file);
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	const char* path = argc > 1 ? argv[1] : "blit_bench_results.json";
+	const size_t sprite_counts[] = { 1000, 10000 };
+	const float scales[] = { 1.0f, 1.5f };
+	const blit_filter filters[] = { BLIT_FILTER_NEAREST, BLIT_FILTER_BILINEAR };
+	const blit_simd best = software_blit::get_simd();
+
+	jobs::initialise();
+	printf("%d workers\n", jobs::get_worker_count());
+	SDL_Surface* framebuffer = SDL_CreateRGBSurfaceWithFormat(0, FRAMEBUFFER_WIDTH, FRAMEBUFFER_HEIGHT, 32, SDL_PIXELFORMAT_RGBA32);
+	SDL_Surface* sheet = create_sheet();
+	printf("%-16s %-9s %6s %8s %8s %12s %12s\n", "benchmark", "filter", "scale", "sprites", "frames", "total ms", "ms/frame");
+	for (size_t count : sprite_counts) {
+		size_t frames = SDL_max(10, 200000 / count);
+		for (float scale : scales) {
+			std::vector<sprite> sprites = create_sprites(count, scale);
+			for (blit_filter filter : filters) {
+				bench_blit("blit_scalar", BLIT_SIMD_SCALAR, framebuffer, sheet, sprites, filter, scale, frames);
+				bench_blit("blit_sse2", BLIT_SIMD_SSE2, framebuffer, sheet, sprites, filter, scale, frames);
+				bench_blit("blit_avx2", BLIT_SIMD_AVX2, framebuffer, sheet, sprites, filter, scale, frames);
+				software_blit::set_simd(best);
+				bench_tiled(framebuffer, sheet, sprites, filter, scale, frames);
+				bench_sdl(framebuffer, sheet, sprites, filter, scale, frames);
+			}
+		}
+	}
+	SDL_FreeSurface(sheet);
+	SDL_FreeSurface(framebuffer);
+	jobs::shutdown();
+
+	if (!write_results(path)) {
+		printf("Could not write %s\n", path);
+		return 1;
+	}
+	printf("Results written to %s\n", path);
+	return 0;
+}
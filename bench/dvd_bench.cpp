@@ -0,0 +1,225 @@
+// DVD ECS micro benchmarks - headless, no window and no SDL libraries needed (only the headers)
+// Build & run (Linux):
+//	g++ -std=c++20 -O2 -DNDEBUG -Iinclude bench/dvd_bench.cpp src/arena.cpp src/profiler.cpp -o dvd_bench
+//	./dvd_bench [results.json]
+// Results are printed as a table and written as JSON so runs can be diffed against each other
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+#include <SDL/SDL_rect.h>
+
+#define MAXIMUM_ENTITIES (100000 + 2)
+
+#include "dvd.h"
+
+struct velocity
+{
+	float x, y;
+};
+
+COMPONENT_AREA_START
+COMPONENT(bench, SDL_FPoint, position)
+COMPONENT(bench, velocity, velocity)
+COMPONENT(bench, float, health)
+COMPONENT(bench, float, speed)
+COMPONENT(bench, SDL_FRect, rect)
+COMPONENT(bench, SDL_Colour, colour)
+COMPONENT(bench, int, layer)
+COMPONENT(bench, SDL_Point, sprite)
+COMPONENT_AREA_END
+
+#include "dvd_ecs.h"
+
+struct bench_result
+{
+	const char* name;
+	size_t entities;
+	size_t components;
+	size_t operations;
+	double total_ms;
+};
+
+static std::vector<bench_result> results;
+
+static double milliseconds_since(std::chrono::steady_clock::time_point start)
+{
+	using namespace std::chrono;
+	return duration<double, std::milli>(steady_clock::now() - start).count();
+}
+
+static void report(const char* name, size_t entities, size_t components, size_t operations, double total_ms)
+{
+	results.push_back({ name, entities, components, operations, total_ms });
+	printf("%-16s %8zu %4zu %10zu %12.3f %12.2f\n", name, entities, components, operations, total_ms, total_ms * 1000000.0 / operations);
+}
+
+// Keeps the optimiser from throwing the iteration work away
+static volatile float sink;
+
+static void set_components(DVD_entity e, size_t count)
+{
+	// Falls through on purpose, count components from the bottom up
+	switch (count) {
+		default:
+		case 8: bench_sprite_set(e, { 1, 1 }); [[fallthrough]];
+		case 7: bench_layer_set(e, 1); [[fallthrough]];
+		case 6: bench_colour_set(e, { 255, 255, 255, 255 }); [[fallthrough]];
+		case 5: bench_rect_set(e, { 0, 0, 16, 16 }); [[fallthrough]];
+		case 4: bench_speed_set(e, 2.0f); [[fallthrough]];
+		case 3: bench_health_set(e, 100.0f); [[fallthrough]];
+		case 2: bench_velocity_set(e, { 1.0f, 0.5f }); [[fallthrough]];
+		case 1: bench_position_set(e, { 0.0f, 0.0f });
+	}
+}
+
+static DVD_signature query_signature(size_t count)
+{
+	return count >= 2 ? DVD_signature_create(2, bench_position_id, bench_velocity_id) : DVD_signature_create(1, bench_position_id);
+}
+
+static void move_system(DVD_entity e)
+{
+	SDL_FPoint* position = bench_position_get(e);
+	if (bench_velocity_exists(e)) {
+		velocity v = *bench_velocity_get(e);
+		position->x += v.x;
+		position->y += v.y;
+	}
+	else {
+		position->x += 1.0f;
+	}
+}
+
+static void reset()
+{
+	DVD_systems_remove_all();
+	DVD_entities_clear();
+	DVD_entities_initialise();
+}
+
+static void populate(size_t entities, size_t components)
+{
+	for (size_t i = 0; i < entities; i++) {
+		set_components(DVD_entities_create(), components);
+	}
+}
+
+static void bench_create(size_t entities, size_t components)
+{
+	reset();
+	auto start = std::chrono::steady_clock::now();
+	populate(entities, components);
+	report("create", entities, components, entities, milliseconds_since(start));
+}
+
+static void bench_create_copy(size_t entities, size_t components)
+{
+	reset();
+	DVD_entity prototype = DVD_entities_create();
+	set_components(prototype, components);
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 1; i < entities; i++) {
+		DVD_entities_create_copy(prototype);
+	}
+	report("create_copy", entities, components, entities - 1, milliseconds_since(start));
+}
+
+static void bench_filter(size_t entities, size_t components)
+{
+	reset();
+	populate(entities, components);
+	DVD_signature signature = query_signature(components);
+	size_t repeats = SDL_max(1, 1000000 / entities);
+	size_t found = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < repeats; i++) {
+		DVD_filter f = DVD_entities_filter(&signature);
+		found += f.count;
+		arena::frame().reset();
+	}
+	report("filter", entities, components, repeats, milliseconds_since(start));
+	sink = (float)found;
+}
+
+static void bench_iterate(size_t entities, size_t components)
+{
+	reset();
+	populate(entities, components);
+	DVD_systems_add_on_update(query_signature(components), move_system);
+	size_t repeats = SDL_max(1, 1000000 / entities);
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < repeats; i++) {
+		DVD_systems_run_update();
+	}
+	report("iterate", entities, components, repeats * entities, milliseconds_since(start));
+	sink = bench_position_get(DVD_entities_used[0])->x;
+}
+
+static void bench_destroy_middle(size_t entities, size_t components)
+{
+	reset();
+	populate(entities, components);
+	// Every destroy from the middle shifts the used list, so only a slice gets timed
+	size_t destroys = SDL_min(entities / 2, 1000);
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < destroys; i++) {
+		DVD_entity e = DVD_entities_used[DVD_entities_used_pivot / 2];
+		DVD_entities_destroy(&e);
+	}
+	report("destroy_middle", entities, components, destroys, milliseconds_since(start));
+}
+
+static void bench_clear(size_t entities, size_t components)
+{
+	reset();
+	populate(entities, components);
+	auto start = std::chrono::steady_clock::now();
+	DVD_entities_clear();
+	report("clear", entities, components, entities, milliseconds_since(start));
+}
+
+static bool write_results(const char* path)
+{
+	FILE* file = fopen(path, "w");
+	if (file == nullptr) {
+		return false;
+	}
+	fprintf(file, "{\n\t\"maximum_entities\": %d,\n\t\"maximum_components\": %d,\n\t\"results\": [\n", MAXIMUM_ENTITIES, MAXIMUM_COMPONENTS);
+	for (size_t i = 0; i < results.size(); i++) {
+		const bench_result& r = results[i];
+		fprintf(file, "\t\t{ \"name\": \"%s\", \"entities\": %zu, \"components\": %zu, \"operations\": %zu, \"total_ms\": %.6f, \"ns_per_op\": %.3f }%s\n",
+			r.name, r.entities, r.components, r.operations, r.total_ms, r.total_ms * 1000000.0 / r.operations,
+			i + 1 < results.size() ? "," : "");
+	}
+	fprintf(file, "\t]\n}\n");
+	fclose(file);
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	const char* path = argc > 1 ? argv[1] : "dvd_bench_results.json";
+	const size_t entity_counts[] = { 1000, 10000, 100000 };
+	const size_t component_counts[] = { 1, 4, 8 };
+
+	arena::initialise(MAXIMUM_ENTITIES * sizeof(DVD_entity), 0);
+	DVD_entities_initialise();
+	printf("%-16s %8s %4s %10s %12s %12s\n", "benchmark", "entities", "comp", "ops", "total ms", "ns/op");
+	for (size_t entities : entity_counts) {
+		for (size_t components : component_counts) {
+			bench_create(entities, components);
+			bench_create_copy(entities, components);
+			bench_filter(entities, components);
+			bench_iterate(entities, components);
+			bench_destroy_middle(entities, components);
+			bench_clear(entities, components);
+		}
+	}
+
+	if (!write_results(path)) {
+		printf("Could not write %s\n", path);
+		return 1;
+	}
+	printf("Results written to %s\n", path);
+	return 0;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <stddef.h>
+#include <atomic>
+
+// Linear allocator, allocating bumps an offset and reset releases everything in one go
+// Nothing gets destructed on reset, so only put trivially destructible stuff in here
+struct arena
+{
+	unsigned char* memory{ nullptr };
+	size_t capacity{ 0 };
+	std::atomic<size_t> offset{ 0 };
+	size_t peak{ 0 };
+
+	void create(size_t size);
+	void destroy();
+	// Returns nullptr when the arena is full, safe to call from several threads at once
+	void* allocate(size_t size, size_t alignment = alignof(max_align_t));
+	void reset();
+
+	template<typename type>
+	type* allocate_array(size_t count)
+	{
+		return (type*)allocate(sizeof(type) * count, alignof(type));
+	}
+
+	// Reset at the end of every frame
+	static arena& frame();
+	// Reset whenever the scene changes
+	static arena& scene();
+	static void initialise(size_t frame_capacity, size_t scene_capacity);
+	static void shutdown();
+};
@@ -0,0 +1,21 @@
+#pragma once
+#include <functional>
+
+// Loads files on a few background threads of its own, so decoding never waits behind or holds up the frame's jobs
+// work runs on a loader thread, done runs on the main thread from poll once its work finished
+struct asset_loader
+{
+	using task = std::function<void()>;
+
+	// thread_count 0 runs the work inline in load, done still waits for poll
+	static void initialise(int thread_count = 2);
+	// Finishes everything queued and runs what is left of the done tasks
+	static void shutdown();
+
+	static void load(const task& work, const task& done);
+	// Main thread, once per frame, runs done for every finished load in the order they finished
+	static void poll();
+	// Main thread, returns once everything loaded so far is done
+	static void wait_all();
+	static int get_pending_count();
+};
@@ -0,0 +1,64 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include "SDL/SDL_stdinc.h"
+
+struct SDL_Surface;
+
+// Everything startup would decode, decoded once offline by the asset packer (tools/asset_packer.cpp)
+// Layout: header, the data of every entry aligned to ASSET_PACK_ALIGNMENT, then the table of contents at toc_offset
+#define ASSET_PACK_MAGIC 0x4b504456 // "VDPK"
+#define ASSET_PACK_VERSION 2
+#define ASSET_PACK_ALIGNMENT 64
+#define ASSET_PACK_NAME_SIZE 96
+
+enum asset_pack_type
+{
+	// RGBA32 pixels, rows pitch bytes apart
+	ASSET_PACK_IMAGE,
+	// An sdf_font cache, the glyph fields and metrics of a baked TTF, fixed width so it is the same on every platform
+	ASSET_PACK_FONT
+};
+
+struct asset_pack_header
+{
+	Uint32 magic;
+	Uint32 version;
+	Uint32 entry_count;
+	Uint32 reserved;
+	Uint64 toc_offset;
+};
+
+struct asset_pack_entry
+{
+	// The path the asset was packed from, the engine looks assets up by the path they are loaded with
+	char name[ASSET_PACK_NAME_SIZE];
+	Uint32 type;
+	Uint32 format;
+	Sint32 width;
+	Sint32 height;
+	Sint32 pitch;
+	Uint32 reserved;
+	Uint64 offset;
+	Uint64 size;
+};
+
+// Maps a pack into memory and hands out what is in it without copying, the mapping stays until close
+struct asset_pack
+{
+	bool open(const char* path);
+	void close();
+	bool is_open() const;
+
+	const asset_pack_entry* find(const char* name) const;
+	const void* get_data(const asset_pack_entry& entry) const;
+	// Points straight at the mapped pixels, free the surface before the pack is closed
+	SDL_Surface* create_surface(const asset_pack_entry& entry) const;
+
+private:
+	bool validate();
+
+	const unsigned char* mapped{ nullptr };
+	size_t mapped_size{ 0 };
+	std::unordered_map<std::string, const asset_pack_entry*> entries;
+};
@@ -0,0 +1,225 @@
+#pragma once
+#include <stddef.h>
+#include <deque>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A handle only fits the registry of its type, and goes stale instead of pointing at whatever reuses its slot
+template<typename type>
+struct asset_handle
+{
+	unsigned int index{ 0 };
+	unsigned int generation{ 0 };
+
+	bool is_valid() const
+	{
+		return generation != 0;
+	}
+};
+
+// Assets of one type by path, loading a path that is already in gives the same asset with one reference more
+// Assets nobody references stay loaded in case they are asked for again, until the bytes of everything in
+// the registry go over budget, then the ones released longest ago are unloaded first
+// Main thread only, assets never move so pointers from get stay valid until the asset is unloaded
+template<typename type>
+struct asset_registry
+{
+	using handle = asset_handle<type>;
+	using unload_function = std::function<void(type& asset)>;
+
+	void create(size_t budget_bytes, const unload_function& unload_asset)
+	{
+		destroy();
+		budget = budget_bytes;
+		unload = unload_asset;
+	}
+
+	// Unloads everything, referenced or not
+	void destroy()
+	{
+		for (size_t i = 0; i < entries.size(); i++) {
+			if (entries[i].generation != 0) {
+				remove((unsigned int)i);
+			}
+		}
+		entries.clear();
+		free_slots.clear();
+		by_path.clear();
+		used_bytes = 0;
+	}
+
+	// A reference more on the asset loaded from path, invalid when it is not in
+	handle acquire(const char* path)
+	{
+		auto found = by_path.find(path);
+		if (found == by_path.end()) {
+			return {};
+		}
+		entry& e = entries[found->second];
+		e.references += 1;
+		return { found->second, e.generation };
+	}
+
+	// Without taking a reference, for whatever has to find an asset by path without keeping it
+	handle find(const char* path)
+	{
+		auto found = by_path.find(path);
+		if (found == by_path.end()) {
+			return {};
+		}
+		return { found->second, entries[found->second].generation };
+	}
+
+	template<typename function>
+	void for_each(function f)
+	{
+		for (auto& [path, index] : by_path) {
+			f(path, handle{ index, entries[index].generation });
+		}
+	}
+
+	// Takes the asset over with one reference, bytes can still be set once it finished loading
+	handle add(const char* path, type&& asset, size_t bytes = 0)
+	{
+		unsigned int index;
+		if (!free_slots.empty()) {
+			index = free_slots.back();
+			free_slots.pop_back();
+		}
+		else {
+			index = (unsigned int)entries.size();
+			entries.emplace_back();
+		}
+		entry& e = entries[index];
+		e.asset = std::move(asset);
+		e.path = path;
+		e.bytes = bytes;
+		e.references = 1;
+		e.released = 0;
+		e.generation = next_generation++;
+		by_path[e.path] = index;
+		used_bytes += bytes;
+		evict();
+		return { index, e.generation };
+	}
+
+	void add_reference(handle h)
+	{
+		if (entry* e = find(h)) {
+			e->references += 1;
+		}
+	}
+
+	// The asset stays loaded without references until the budget needs its bytes
+	void release(handle h)
+	{
+		entry* e = find(h);
+		if (e == nullptr || e->references == 0) {
+			return;
+		}
+		e->references -= 1;
+		if (e->references == 0) {
+			e->released = ++release_stamp;
+			evict();
+		}
+	}
+
+	type* get(handle h)
+	{
+		entry* e = find(h);
+		return e != nullptr ? &e->asset : nullptr;
+	}
+
+	void set_bytes(handle h, size_t bytes)
+	{
+		if (entry* e = find(h)) {
+			used_bytes = used_bytes - e->bytes + bytes;
+			e->bytes = bytes;
+			evict();
+		}
+	}
+
+	void set_budget(size_t budget_bytes)
+	{
+		budget = budget_bytes;
+		evict();
+	}
+
+	size_t get_used_bytes() const
+	{
+		return used_bytes;
+	}
+
+	size_t get_budget() const
+	{
+		return budget;
+	}
+
+	size_t count() const
+	{
+		return by_path.size();
+	}
+
+private:
+	struct entry
+	{
+		type asset{};
+		std::string path;
+		size_t bytes{ 0 };
+		unsigned int references{ 0 };
+		// When the last reference went, the lowest goes first
+		unsigned long long released{ 0 };
+		// 0 while the slot is free
+		unsigned int generation{ 0 };
+	};
+
+	entry* find(handle h)
+	{
+		if (h.generation == 0 || h.index >= entries.size() || entries[h.index].generation != h.generation) {
+			return nullptr;
+		}
+		return &entries[h.index];
+	}
+
+	void remove(unsigned int index)
+	{
+		entry& e = entries[index];
+		if (unload) {
+			unload(e.asset);
+		}
+		by_path.erase(e.path);
+		used_bytes -= e.bytes;
+		e = entry{};
+		free_slots.push_back(index);
+	}
+
+	// Referenced assets are never unloaded, the budget can stay exceeded when they need more than it
+	void evict()
+	{
+		while (used_bytes > budget) {
+			size_t oldest = entries.size();
+			for (size_t i = 0; i < entries.size(); i++) {
+				const entry& e = entries[i];
+				if (e.generation != 0 && e.references == 0 && (oldest == entries.size() || e.released < entries[oldest].released)) {
+					oldest = i;
+				}
+			}
+			if (oldest == entries.size()) {
+				return;
+			}
+			remove((unsigned int)oldest);
+		}
+	}
+
+	// A deque so assets keep their address when more are added
+	std::deque<entry> entries;
+	std::vector<unsigned int> free_slots;
+	std::unordered_map<std::string, unsigned int> by_path;
+	size_t budget{ (size_t)-1 };
+	size_t used_bytes{ 0 };
+	unsigned int next_generation{ 1 };
+	unsigned long long release_stamp{ 0 };
+	unload_function unload;
+};
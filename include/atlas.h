@@ -0,0 +1,78 @@
+#pragma once
+#include <mutex>
+#include <vector>
+#include "SDL/SDL_rect.h"
+
+struct SDL_Renderer;
+struct SDL_Surface;
+struct SDL_Texture;
+
+// Skyline bottom-left packer, only knows about rectangles so it can be reused for glyphs and such
+struct rect_packer
+{
+	void create(int width, int height);
+	bool pack(int width, int height, SDL_Point& out_position);
+	void clear();
+
+private:
+	struct skyline_node
+	{
+		int x, y, width;
+	};
+
+	int fit(size_t index, int width, int height) const;
+
+	int page_width{ 0 };
+	int page_height{ 0 };
+	std::vector<skyline_node> skyline;
+};
+
+typedef int atlas_handle;
+#define INVALID_ATLAS_HANDLE -1
+
+struct atlas_region
+{
+	SDL_Texture* texture;
+	SDL_Rect rect;
+};
+
+// Merges images into a few shared pages, so draws from different images can go into the same batch
+// add and get belong to the main thread, upload to the render thread, the pixels in between are guarded
+struct texture_atlas
+{
+	void create(SDL_Renderer* renderer, int page_size, int padding = 1);
+	void destroy();
+
+	atlas_handle add(SDL_Surface* surface);
+	atlas_handle add(const char* path);
+	// A handle for an image that is still on its way, its region has no texture until fill packs the image into it
+	atlas_handle reserve();
+	bool fill(atlas_handle handle, SDL_Surface* surface);
+	// New pixels for a region, written over the old ones when the size matches and packed anew when not
+	// Nothing may be drawing from the atlas meanwhile, the software backend reads the pages directly
+	bool replace(atlas_handle handle, SDL_Surface* surface);
+	// Regions are stable, their texture is only valid after upload
+	const atlas_region* get(atlas_handle handle) const;
+	// Sends changed pixels of every page to its texture, cheap when nothing changed
+	void upload();
+	size_t get_page_count() const;
+
+private:
+	struct page
+	{
+		SDL_Surface* pixels;
+		SDL_Texture* texture;
+		rect_packer packer;
+		SDL_Rect dirty;
+	};
+
+	bool create_page(int width, int height, page& out_page);
+	bool place(SDL_Surface* surface, atlas_region& out_region);
+
+	SDL_Renderer* renderer{ nullptr };
+	int page_size{ 0 };
+	int padding{ 0 };
+	std::vector<page> pages;
+	std::vector<atlas_region> regions;
+	std::mutex mutex;
+};
@@ -0,0 +1,35 @@
+#pragma once
+#include <vector>
+#include "software_blit.h"
+
+// Collects software blits and draws them tile by tile, every tile only goes through the blits that touch it
+// and the tiles run in parallel on the job system, a pixel sees the same blits in the same order either way
+// so the frame comes out exactly as if it was drawn on one thread
+struct blit_batch
+{
+	static constexpr int tile_size = 64;
+
+	void add(const SDL_Surface* source, const SDL_Rect& src, const SDL_FRect& dst, SDL_Colour colour, SDL_BlendMode blend, blit_filter filter);
+	// Nothing outside clip is touched, parallel false draws every blit once over the whole clip on the calling thread
+	void flush(SDL_Surface* target, const SDL_Rect* clip = nullptr, bool parallel = true);
+	bool is_empty() const;
+
+private:
+	struct blit
+	{
+		const SDL_Surface* source;
+		SDL_Rect src;
+		SDL_FRect dst;
+		SDL_Colour colour;
+		SDL_BlendMode blend;
+		blit_filter filter;
+	};
+
+	void bin(int columns, int rows);
+
+	// Kept between frames, binning is a counting sort into one list instead of a vector per tile
+	std::vector<blit> blits;
+	std::vector<SDL_Rect> tile_ranges;
+	std::vector<size_t> tile_offsets;
+	std::vector<unsigned int> binned;
+};
@@ -0,0 +1,18 @@
+#pragma once
+#include "SDL/SDL_rect.h"
+
+// Maps world space onto the screen, position is the world point at the top left corner
+struct camera
+{
+	SDL_FPoint position{ 0.0f, 0.0f };
+	float zoom{ 1.0f };
+	SDL_FPoint screen_size{ 0.0f, 0.0f };
+
+	// The part of the world that ends up on screen
+	SDL_FRect get_view() const;
+	bool is_visible(const SDL_FRect& bounds) const;
+
+	SDL_FPoint to_screen(const SDL_FPoint& point) const;
+	SDL_FRect to_screen(const SDL_FRect& rect) const;
+	SDL_FPoint to_world(const SDL_FPoint& point) const;
+};
@@ -0,0 +1,35 @@
+#pragma once
+#include <vector>
+#include "SDL/SDL_rect.h"
+
+struct render_queue;
+
+// Compares the commands of a frame with the ones of the frame before, whatever appeared, disappeared or changed
+// is damage, frames without any damage do not need drawing at all
+// Reordering commands that share their whole sort key is not seen, those are expected to not overlap
+struct damage_tracker
+{
+	// More separate areas than this get merged into one
+	static constexpr size_t max_rects = 8;
+
+	void create(int screen_width, int screen_height);
+	// out_rects gets disjoint screen areas to redraw, returns false when nothing changed
+	// Call before the queue is submitted, the commands have to be in the order they were pushed
+	bool update(const render_queue& queue, std::vector<SDL_Rect>& out_rects);
+	// The next update reports the whole screen, for anything that changes pixels without changing commands
+	void invalidate();
+
+private:
+	struct entry
+	{
+		unsigned long long hash;
+		SDL_Rect bounds;
+	};
+
+	void add_damage(const SDL_Rect& rect, std::vector<SDL_Rect>& rects) const;
+
+	SDL_Rect screen{ 0, 0, 0, 0 };
+	bool invalidated{ true };
+	std::vector<entry> previous;
+	std::vector<entry> current;
+};
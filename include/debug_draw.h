@@ -0,0 +1,41 @@
+#pragma once
+#include "engine.h"
+
+struct SDL_Renderer;
+
+// Debug shapes are only compiled into debug builds, release builds (NDEBUG) turn every call into nothing
+#if !defined(NDEBUG) && !defined(DVD_DEBUG_DRAW_DISABLED)
+#define DVD_DEBUG_DRAW
+#endif
+
+#ifdef DVD_DEBUG_DRAW
+// Records the frame's debug shapes and draws them on top of everything at present, all of them in a single
+// geometry call with the colour in the vertices, the draw colour is never touched
+struct debug_draw
+{
+	static void rect(const SDL_FRect& rect, SDL_Colour colour);
+	static void line(const SDL_FPoint& a, const SDL_FPoint& b, SDL_Colour colour);
+	static void circle(const SDL_FCircle& circle, SDL_Colour colour);
+	static void capsule(const SDL_FHorizontalCapsule& capsule, SDL_Colour colour);
+
+	// Hands the recorded shapes over to flush, only while no flush is running
+	static void swap();
+	static void flush(SDL_Renderer* renderer);
+	// Shapes recorded so far this frame
+	static size_t count();
+};
+
+#define DVD_DEBUG_RECT(rect, ...) debug_draw::rect(rect, __VA_ARGS__)
+#define DVD_DEBUG_LINE(a, b, ...) debug_draw::line(a, b, __VA_ARGS__)
+#define DVD_DEBUG_CIRCLE(circle, ...) debug_draw::circle(circle, __VA_ARGS__)
+#define DVD_DEBUG_CAPSULE(capsule, ...) debug_draw::capsule(capsule, __VA_ARGS__)
+#define DVD_DEBUG_SWAP() debug_draw::swap()
+#define DVD_DEBUG_FLUSH(renderer) debug_draw::flush(renderer)
+#else
+#define DVD_DEBUG_RECT(rect, ...)
+#define DVD_DEBUG_LINE(a, b, ...)
+#define DVD_DEBUG_CIRCLE(circle, ...)
+#define DVD_DEBUG_CAPSULE(capsule, ...)
+#define DVD_DEBUG_SWAP()
+#define DVD_DEBUG_FLUSH(renderer)
+#endif
@@ -0,0 +1,87 @@
+#pragma once
+#include <stddef.h>
+#include <stdio.h>
+#include <SDL/SDL_stdinc.h>
+
+// DVD ECS, part one: types, storage and the component macros
+// Usage (in exactly one translation unit, everything in here lives in static storage):
+//	#include "dvd.h"
+//	COMPONENT_AREA_START
+//	COMPONENT(...)
+//	COMPONENT_AREA_END
+//	#include "dvd_ecs.h"
+
+typedef unsigned char DVD_byte;
+typedef size_t DVD_entity;
+typedef size_t DVD_component_id;
+
+// Invalid entity is 0 should cause a lot of cool out of the box behaviour
+#define INVALID_ENTITY 0
+#define INVALID_COMPONENT size_t(~0)
+
+// Can be overriden before including, the benchmarks need way more than a game of breakout
+#ifndef MAXIMUM_ENTITIES
+#define MAXIMUM_ENTITIES 256
+#endif
+#ifndef MAXIMUM_UPDATE_SYSTEMS
+#define MAXIMUM_UPDATE_SYSTEMS 64
+#endif
+#ifndef MAXIMUM_RENDER_SYSTEMS
+#define MAXIMUM_RENDER_SYSTEMS 32
+#endif
+
+// Entity
+size_t DVD_entities_available_pivot{ MAXIMUM_ENTITIES };
+DVD_entity DVD_entities_available[MAXIMUM_ENTITIES];
+
+size_t DVD_entities_used_pivot{ 0 };
+DVD_entity DVD_entities_used[MAXIMUM_ENTITIES];
+
+bool DVD_entity_used_lookup[MAXIMUM_ENTITIES];
+
+// Header
+bool DVD_entity_is_valid(DVD_entity e);
+void DVD_components_control_try_initialise(DVD_component_id component_index, DVD_byte* buffer_begin, size_t buffer_element_size);
+void DVD_components_control_set_valid(DVD_entity e, DVD_component_id component_index, bool is_valid);
+bool DVD_components_control_is_valid(DVD_entity e, DVD_component_id component_index);
+
+#define COMPONENT(custom_namespace, type, name) \
+type DVD_internal_##name##_buffer[MAXIMUM_ENTITIES]; \
+const DVD_component_id custom_namespace##_##name##_id{ GET_COUNT_AND_INCREMENT }; \
+inline bool custom_namespace##_##name##_exists(const DVD_entity e) \
+{ \
+	if (!DVD_entity_is_valid(e) || custom_namespace##_##name##_id == INVALID_COMPONENT) { \
+		return false; \
+	} \
+	return DVD_components_control_is_valid(e, custom_namespace##_##name##_id); \
+} \
+inline void custom_namespace##_##name##_set(const DVD_entity e, const type v) \
+{ \
+	if (DVD_entity_is_valid(e)) { \
+		DVD_components_control_try_initialise(custom_namespace##_##name##_id, (DVD_byte*)(DVD_internal_##name##_buffer), sizeof(type)); \
+		DVD_components_control_set_valid(e, custom_namespace##_##name##_id, true); \
+		DVD_internal_##name##_buffer[e] = v; \
+	} \
+	else { \
+		printf("Error in %s of type %s", #name, #type); \
+	} \
+} \
+inline type* custom_namespace##_##name##_get(const DVD_entity e) \
+{ \
+	return &DVD_internal_##name##_buffer[e]; \
+} \
+inline void custom_namespace##_##name##_destroy(const DVD_entity e) \
+{ \
+	if (!DVD_entity_is_valid(e) || custom_namespace##_##name##_id == INVALID_COMPONENT) { \
+		DVD_components_control_set_valid(e, custom_namespace##_##name##_id, false); \
+	} \
+} \
+
+// User:
+// Encapsulate all used components with COMPONENT_AREA_START and COMPONENT_AREA_END to count all used components
+// otherwise, if you are lazy, just define MAXIMUM_COMPONENTS with a hardcoded value by yourself
+#define COMPONENT_AREA_START enum COUNTER_BASE { COUNTER_BASE_VALUE = __COUNTER__ };
+#define GET_COUNT_AND_INCREMENT (__COUNTER__ - COUNTER_BASE_VALUE - 1)
+#define COMPONENT_AREA_END enum COMPONENT_COUNT { COMPONENT_COUNT_VALUE = GET_COUNT_AND_INCREMENT };
+#define MAXIMUM_COMPONENTS COMPONENT_COUNT_VALUE
+
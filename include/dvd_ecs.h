@@ -0,0 +1,541 @@
+#pragma once
+#include <string.h>
+#include <stdarg.h>
+#include "dvd.h"
+#include "arena.h"
+#include "profiler.h"
+
+// DVD ECS, part two: needs MAXIMUM_COMPONENTS, so include it after COMPONENT_AREA_END
+
+// In static storage (.cpp/.c)
+size_t DVD_components_buffer_element_size_lookup[MAXIMUM_COMPONENTS]{ 0 };
+DVD_byte* DVD_components_buffer_begin_lookup[MAXIMUM_COMPONENTS]{ nullptr };
+bool DVD_components_valid_lookup[MAXIMUM_ENTITIES * MAXIMUM_COMPONENTS]{ false };
+
+bool DVD_components_control_is_initialised(DVD_component_id component_index)
+{
+	return DVD_components_buffer_element_size_lookup[component_index] != 0;
+}
+void DVD_components_control_initialise(DVD_component_id component_index, DVD_byte* buffer_begin, size_t buffer_element_size)
+{
+	if (component_index >= MAXIMUM_COMPONENTS) {
+		// Error here
+		return;
+	}
+	DVD_components_buffer_element_size_lookup[component_index] = buffer_element_size;
+	DVD_components_buffer_begin_lookup[component_index] = buffer_begin;
+}
+void DVD_components_control_try_initialise(DVD_component_id component_index, DVD_byte* buffer_begin, size_t buffer_element_size)
+{
+	if (!DVD_components_control_is_initialised(component_index)) {
+		DVD_components_control_initialise(component_index, buffer_begin, buffer_element_size);
+	}
+}
+void DVD_components_control_set_valid(DVD_entity e, DVD_component_id component_index, bool is_valid)
+{
+	if (component_index >= MAXIMUM_COMPONENTS) {
+		// Error here
+		return; 
+	}
+	DVD_components_valid_lookup[e * MAXIMUM_COMPONENTS + component_index] = is_valid;
+}
+bool DVD_components_control_is_valid(DVD_entity e, DVD_component_id component_index)
+{
+	return DVD_components_valid_lookup[e * MAXIMUM_COMPONENTS + component_index];
+}
+void DVD_components_single_copy(DVD_component_id component_index, DVD_entity from, DVD_entity to)
+{
+	if (DVD_components_control_is_initialised(component_index)) {
+		size_t element_size = DVD_components_buffer_element_size_lookup[component_index];
+		DVD_byte* start = DVD_components_buffer_begin_lookup[component_index];
+		DVD_byte* src_data = (start)+(from * element_size);
+		DVD_byte* dst_data = (start)+(to * element_size);
+		memcpy(dst_data, src_data, element_size);
+		DVD_components_control_set_valid(to, component_index, DVD_components_control_is_valid(from, component_index));
+	}
+}
+void DVD_components_entities_deep_copy(DVD_entity from, DVD_entity to)
+{
+	for (int i = 0; i < MAXIMUM_COMPONENTS; i++) {
+		DVD_components_single_copy(i, from, to);
+	}
+}
+
+struct DVD_signature
+{
+	bool field[MAXIMUM_COMPONENTS]; 
+	size_t count;
+};
+// list lives in the frame arena, so a filter is only valid until the end of the frame
+struct DVD_filter
+{
+	DVD_entity* list;
+	size_t count;
+};
+void DVD_entities_initialise()
+{
+	for (int i = 0; i < MAXIMUM_ENTITIES; i++) {
+		DVD_entities_available[i] = i;
+		DVD_entities_used[i] = INVALID_ENTITY;
+	}
+}
+bool DVD_entity_is_valid(DVD_entity e)
+{
+	return e < MAXIMUM_ENTITIES && e != INVALID_ENTITY && DVD_entity_used_lookup[e];
+}
+DVD_signature DVD_signature_create_from_entity(const DVD_entity e)
+{
+	bool* start = &DVD_components_valid_lookup[e * MAXIMUM_COMPONENTS + 0];
+
+	DVD_signature signature{ {}, 0 };
+	memset(signature.field, 0, sizeof(signature.field));
+	for (int i = 0; i < MAXIMUM_COMPONENTS; i++) {
+		signature.field[i] = start[i];
+		signature.count = SDL_max(signature.count, i + 1);
+	}
+	return signature;
+}
+DVD_signature DVD_signature_create_intersection_with_entity(const DVD_entity e, size_t count, ...)
+{
+	va_list args;
+	va_start(args, count);
+
+	bool* start = &DVD_components_valid_lookup[e * MAXIMUM_COMPONENTS + 0];
+
+	DVD_signature signature{ {}, 0 };
+	memset(signature.field, 0, sizeof(signature.field));
+	for (int i = 0; i < count; i++) {
+		size_t component_id = va_arg(args, size_t);
+		signature.field[component_id] = start[component_id];
+		signature.count = SDL_max(signature.count, component_id + 1);
+	}
+
+	va_end(args);
+	return signature;
+}
+DVD_signature DVD_signature_create(size_t count, ...)
+{
+	va_list args;
+	va_start(args, count);
+
+	DVD_signature signature{ {}, 0 };
+	memset(signature.field, 0, sizeof(signature.field));
+	for (int i = 0; i < count; i++) {
+		DVD_component_id component_id = va_arg(args, size_t);
+		signature.field[component_id] = true;
+		signature.count = SDL_max(signature.count, component_id + 1);
+	}
+
+	va_end(args);
+	return signature;
+}
+bool DVD_signature_entity_fulfils(const DVD_entity e, const DVD_signature* signa)
+{
+	bool* entity_signature = &DVD_components_valid_lookup[e * MAXIMUM_COMPONENTS + 0];
+	for (int i = 0; i < signa->count; i++) {
+		bool is_relevant = signa->field[i];
+		if (is_relevant && entity_signature[i] != is_relevant) {
+			return false;
+		}
+	}
+	return true;
+}
+DVD_filter DVD_entities_filter(const DVD_signature* signature)
+{
+	DVD_filter f { arena::frame().allocate_array<DVD_entity>(DVD_entities_used_pivot), 0 };
+	if (f.list == nullptr) {
+		return f;
+	}
+	for (int i = 0; i < DVD_entities_used_pivot; i++) {
+		DVD_entity e = DVD_entities_used[i];
+		if (DVD_signature_entity_fulfils(e, signature)) {
+			f.list[f.count] = e;
+			f.count += 1;
+		}
+	}
+	return f;
+}
+DVD_filter DVD_entities_filter_ex(const DVD_signature* signa, const DVD_signature* can_not_have)
+{
+	DVD_filter f{ arena::frame().allocate_array<DVD_entity>(DVD_entities_used_pivot), 0 };
+	if (f.list == nullptr) {
+		return f;
+	}
+	for (int i = 0; i < DVD_entities_used_pivot; i++) {
+		DVD_entity e = DVD_entities_used[i];
+		if (DVD_signature_entity_fulfils(e, signa) && !DVD_signature_entity_fulfils(e, can_not_have)) {
+			f.list[f.count] = e;
+			f.count += 1;
+		}
+	}
+	return f;
+}
+bool DVD_signature_is_identical(const DVD_signature* lhs, const DVD_signature* rhs)
+{
+	size_t max;
+	size_t min;
+	const DVD_signature* check;
+
+	if (lhs->count > rhs->count) {
+		check = lhs;
+		min = rhs->count;
+		max = lhs->count;
+	}
+	else {
+		check = rhs;
+		min = lhs->count;
+		max = rhs->count;
+	}
+
+	for (size_t i = min; i < max; i++) {
+		if (check->field[i]) {
+			return false;
+		}
+	}
+	for (size_t i = 0; i < min; i++) {
+		if (lhs->field[i] != rhs->field[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+DVD_entity DVD_entities_create()
+{
+	if (DVD_entities_available_pivot == 0) {
+		return INVALID_ENTITY;
+	}
+	DVD_entities_available_pivot -= 1;
+	DVD_entity e = DVD_entities_available[DVD_entities_available_pivot];
+	DVD_entities_available[DVD_entities_available_pivot] = INVALID_ENTITY;
+	DVD_entities_used[DVD_entities_used_pivot] = e;
+	DVD_entities_used_pivot += 1;
+	DVD_entity_used_lookup[e] = true;
+	return e;
+}
+DVD_entity DVD_entities_create_copy(DVD_entity of)
+{
+	DVD_entity e = DVD_entities_create();
+	DVD_components_entities_deep_copy(of, e);
+	return e;
+}
+void DVD_entities_invalidate_components(DVD_entity e)
+{
+	bool* start = &DVD_components_valid_lookup[e * MAXIMUM_COMPONENTS + 0];
+	memset(start, 0, sizeof(bool) * MAXIMUM_COMPONENTS);
+}
+void DVD_entities_destroy(DVD_entity* e)
+{
+	if (DVD_entities_used[DVD_entities_used_pivot - 1] == *e) { // just track one back if we remove last one
+		DVD_entities_invalidate_components(*e); // meh, let's just try this
+		DVD_entity_used_lookup[*e] = false;
+		DVD_entities_available[DVD_entities_available_pivot] = *e;
+		DVD_entities_available_pivot += 1;
+		DVD_entities_used_pivot -= 1;
+		DVD_entities_used[DVD_entities_used_pivot] = INVALID_ENTITY;
+	}
+	else {
+		// otherwise... find...
+		for (size_t i = 0; i < DVD_entities_used_pivot; i++) {
+			DVD_entity target = DVD_entities_used[i];
+			if (target == *e) { // found 
+				// shift over 
+				for (size_t j = i; j < DVD_entities_used_pivot - 1; j++) {
+					DVD_entities_used[j] = DVD_entities_used[j + 1];
+				}
+				// How to invalidate all the commponents? :( Entity signature? Maybe? No. FUCK!
+				DVD_entities_invalidate_components(*e); // meh, let's just try this
+				DVD_entity_used_lookup[*e] = false;
+				DVD_entities_available[DVD_entities_available_pivot] = *e;
+				DVD_entities_available_pivot += 1;
+				DVD_entities_used_pivot -= 1;
+				DVD_entities_used[DVD_entities_used_pivot] = INVALID_ENTITY;
+				break;
+			}
+		}
+	}
+}
+void DVD_entities_clear()
+{
+	for (int i = DVD_entities_used_pivot - 1; i >= 0; i--) {
+		DVD_entities_destroy(&DVD_entities_used[i]);
+	}
+}
+
+typedef void(*DVD_systems_function)(DVD_entity);
+
+// Update systems run phase by phase, render systems are the render phase
+enum DVD_phase
+{
+	DVD_PHASE_INPUT,
+	DVD_PHASE_SIMULATE,
+	DVD_PHASE_COLLIDE,
+	DVD_PHASE_SYNC,
+	DVD_PHASE_RENDER,
+	DVD_PHASE_COUNT
+};
+
+size_t DVD_systems_internal_update_buffer_pivot{ 0 };
+DVD_signature DVD_systems_internal_update_signatures[MAXIMUM_UPDATE_SYSTEMS];
+DVD_systems_function DVD_systems_internal_update_buffer[MAXIMUM_UPDATE_SYSTEMS];
+const char* DVD_systems_internal_update_names[MAXIMUM_UPDATE_SYSTEMS];
+DVD_phase DVD_systems_internal_update_phases[MAXIMUM_UPDATE_SYSTEMS];
+size_t DVD_systems_internal_update_schedule[MAXIMUM_UPDATE_SYSTEMS];
+
+size_t DVD_systems_internal_render_buffer_pivot{ 0 };
+DVD_signature DVD_systems_internal_render_signatures[MAXIMUM_RENDER_SYSTEMS];
+DVD_systems_function DVD_systems_internal_render_buffer[MAXIMUM_RENDER_SYSTEMS];
+const char* DVD_systems_internal_render_names[MAXIMUM_RENDER_SYSTEMS];
+DVD_phase DVD_systems_internal_render_phases[MAXIMUM_RENDER_SYSTEMS];
+size_t DVD_systems_internal_render_schedule[MAXIMUM_RENDER_SYSTEMS];
+
+// "first runs before second", only applies when both sit in the same buffer
+struct DVD_systems_constraint
+{
+	DVD_systems_function first;
+	DVD_systems_function second;
+};
+#define MAXIMUM_SYSTEM_CONSTRAINTS (MAXIMUM_UPDATE_SYSTEMS + MAXIMUM_RENDER_SYSTEMS)
+size_t DVD_systems_internal_constraints_pivot{ 0 };
+DVD_systems_constraint DVD_systems_internal_constraints[MAXIMUM_SYSTEM_CONSTRAINTS];
+
+// Schedules get rebuilt on the next run whenever registration changes
+bool DVD_systems_internal_schedule_dirty{ true };
+
+// When set, render systems only visit the entities this returns, once per frame, instead of every entity
+// Meant for a spatial index query against the camera, so a large level only costs what is on screen
+typedef DVD_filter(*DVD_systems_visibility_function)();
+DVD_systems_visibility_function DVD_systems_internal_render_visibility{ nullptr };
+
+// Systems get registered through the macros below so the profiler knows their names
+#define DVD_systems_add_on_update(signature, func) DVD_systems_internal_add_on_update(signature, func, #func, DVD_PHASE_SIMULATE)
+#define DVD_systems_add_on_render(signature, func) DVD_systems_internal_add_on_render(signature, func, #func)
+#define DVD_systems_add_in_phase(phase, signature, func) \
+	((phase) == DVD_PHASE_RENDER ? DVD_systems_internal_add_on_render(signature, func, #func) : DVD_systems_internal_add_on_update(signature, func, #func, phase))
+
+bool DVD_systems_internal_add_on_update(DVD_signature signature, DVD_systems_function func, const char* name, DVD_phase phase)
+{
+	if (DVD_systems_internal_update_buffer_pivot >= MAXIMUM_UPDATE_SYSTEMS || phase >= DVD_PHASE_RENDER) {
+		return false;
+	}
+	DVD_systems_internal_update_buffer[DVD_systems_internal_update_buffer_pivot] = func;
+	DVD_systems_internal_update_names[DVD_systems_internal_update_buffer_pivot] = name;
+	DVD_systems_internal_update_phases[DVD_systems_internal_update_buffer_pivot] = phase;
+	memcpy(&DVD_systems_internal_update_signatures[DVD_systems_internal_update_buffer_pivot], &signature, sizeof(signature));
+	DVD_systems_internal_update_buffer_pivot += 1;
+	DVD_systems_internal_schedule_dirty = true;
+	return true;
+}
+bool DVD_systems_internal_add_on_render(DVD_signature signature, DVD_systems_function func, const char* name)
+{
+	if (DVD_systems_internal_render_buffer_pivot >= MAXIMUM_RENDER_SYSTEMS) {
+		return false;
+	}
+	memcpy(&DVD_systems_internal_render_signatures[DVD_systems_internal_render_buffer_pivot], &signature, sizeof(signature));
+	DVD_systems_internal_render_buffer[DVD_systems_internal_render_buffer_pivot] = func;
+	DVD_systems_internal_render_names[DVD_systems_internal_render_buffer_pivot] = name;
+	DVD_systems_internal_render_phases[DVD_systems_internal_render_buffer_pivot] = DVD_PHASE_RENDER;
+	DVD_systems_internal_render_buffer_pivot += 1;
+	DVD_systems_internal_schedule_dirty = true;
+	return true;
+}
+bool DVD_systems_internal_remove_and_shift_buffer(DVD_systems_function* buffer, DVD_signature* signatures, const char** names, DVD_phase* phases, size_t* pivot, DVD_systems_function compare)
+{
+	for (size_t i = 0; i < *pivot; i++) {
+		DVD_systems_function target = buffer[i];
+		if (target == compare) { // found 
+			// shift over, everything parallel to the function has to move along with it
+			for (size_t j = i; j < *pivot - 1; j++) {
+				buffer[j] = buffer[j + 1];
+				signatures[j] = signatures[j + 1];
+				names[j] = names[j + 1];
+				phases[j] = phases[j + 1];
+			}
+			*pivot -= 1;
+			// No need to actually do this, but it keeps the memory clean and dandy
+			buffer[*pivot] = nullptr;
+			names[*pivot] = nullptr;
+			DVD_systems_internal_schedule_dirty = true;
+			return true;
+		}
+	}
+	return false;
+}
+bool DVD_systems_set_phase(DVD_systems_function func, DVD_phase phase)
+{
+	if (phase >= DVD_PHASE_RENDER) {
+		return false;
+	}
+	for (size_t i = 0; i < DVD_systems_internal_update_buffer_pivot; i++) {
+		if (DVD_systems_internal_update_buffer[i] == func) {
+			DVD_systems_internal_update_phases[i] = phase;
+			DVD_systems_internal_schedule_dirty = true;
+			return true;
+		}
+	}
+	return false;
+}
+bool DVD_systems_run_before(DVD_systems_function first, DVD_systems_function second)
+{
+	if (DVD_systems_internal_constraints_pivot >= MAXIMUM_SYSTEM_CONSTRAINTS) {
+		return false;
+	}
+	DVD_systems_internal_constraints[DVD_systems_internal_constraints_pivot] = { first, second };
+	DVD_systems_internal_constraints_pivot += 1;
+	DVD_systems_internal_schedule_dirty = true;
+	return true;
+}
+bool DVD_systems_run_after(DVD_systems_function second, DVD_systems_function first)
+{
+	return DVD_systems_run_before(first, second);
+}
+void DVD_systems_remove_all_update()
+{
+	DVD_systems_internal_update_buffer_pivot = 0;
+	DVD_systems_internal_schedule_dirty = true;
+}
+void DVD_systems_remove_all_render()
+{
+	DVD_systems_internal_render_buffer_pivot = 0;
+	DVD_systems_internal_schedule_dirty = true;
+}
+void DVD_systems_set_render_visibility(DVD_systems_visibility_function func)
+{
+	DVD_systems_internal_render_visibility = func;
+}
+void DVD_systems_remove_all()
+{
+	DVD_systems_remove_all_update();
+	DVD_systems_remove_all_render();
+	DVD_systems_internal_constraints_pivot = 0;
+	DVD_systems_internal_render_visibility = nullptr;
+}
+bool DVD_systems_remove_on_update(DVD_systems_function func)
+{
+	return DVD_systems_internal_remove_and_shift_buffer(DVD_systems_internal_update_buffer, DVD_systems_internal_update_signatures, DVD_systems_internal_update_names, DVD_systems_internal_update_phases, &DVD_systems_internal_update_buffer_pivot, func);
+}
+bool DVD_systems_remove_on_render(DVD_systems_function func)
+{
+	return DVD_systems_internal_remove_and_shift_buffer(DVD_systems_internal_render_buffer, DVD_systems_internal_render_signatures, DVD_systems_internal_render_names, DVD_systems_internal_render_phases, &DVD_systems_internal_render_buffer_pivot, func);
+}
+// Topological sort (Kahn), whenever several systems are ready the one in the earliest phase, then earliest registered, goes first
+void DVD_systems_internal_build_schedule(const DVD_systems_function* buffer, const DVD_phase* phases, const char** names, size_t pivot, size_t* schedule)
+{
+	size_t incoming[MAXIMUM_UPDATE_SYSTEMS > MAXIMUM_RENDER_SYSTEMS ? MAXIMUM_UPDATE_SYSTEMS : MAXIMUM_RENDER_SYSTEMS]{ 0 };
+	bool scheduled[MAXIMUM_UPDATE_SYSTEMS > MAXIMUM_RENDER_SYSTEMS ? MAXIMUM_UPDATE_SYSTEMS : MAXIMUM_RENDER_SYSTEMS]{ false };
+
+	for (size_t c = 0; c < DVD_systems_internal_constraints_pivot; c++) {
+		const DVD_systems_constraint& constraint = DVD_systems_internal_constraints[c];
+		for (size_t i = 0; i < pivot; i++) {
+			for (size_t j = 0; j < pivot; j++) {
+				if (buffer[i] == constraint.first && buffer[j] == constraint.second) {
+					incoming[j] += 1;
+					if (phases[i] > phases[j]) {
+						printf("Constraint puts %s (phase %d) before %s (phase %d)\n", names[i], phases[i], names[j], phases[j]);
+					}
+				}
+			}
+		}
+	}
+
+	size_t count{ 0 };
+	while (count < pivot) {
+		size_t next = pivot;
+		for (size_t i = 0; i < pivot; i++) {
+			if (!scheduled[i] && incoming[i] == 0 && (next == pivot || phases[i] < phases[next])) {
+				next = i;
+			}
+		}
+		if (next == pivot) {
+			break;
+		}
+		scheduled[next] = true;
+		schedule[count] = next;
+		count += 1;
+		for (size_t c = 0; c < DVD_systems_internal_constraints_pivot; c++) {
+			const DVD_systems_constraint& constraint = DVD_systems_internal_constraints[c];
+			if (buffer[next] != constraint.first) {
+				continue;
+			}
+			for (size_t j = 0; j < pivot; j++) {
+				if (buffer[j] == constraint.second) {
+					incoming[j] -= 1;
+				}
+			}
+		}
+	}
+
+	if (count < pivot) {
+		// Cycle, run whatever is left in registration order so nothing silently stops running
+		printf("System constraints contain a cycle, falling back to registration order for:");
+		for (size_t i = 0; i < pivot; i++) {
+			if (!scheduled[i]) {
+				printf(" %s", names[i]);
+				schedule[count] = i;
+				count += 1;
+			}
+		}
+		printf("\n");
+	}
+}
+void DVD_systems_internal_try_build_schedules()
+{
+	if (!DVD_systems_internal_schedule_dirty) {
+		return;
+	}
+	DVD_systems_internal_build_schedule(DVD_systems_internal_update_buffer, DVD_systems_internal_update_phases, DVD_systems_internal_update_names, DVD_systems_internal_update_buffer_pivot, DVD_systems_internal_update_schedule);
+	DVD_systems_internal_build_schedule(DVD_systems_internal_render_buffer, DVD_systems_internal_render_phases, DVD_systems_internal_render_names, DVD_systems_internal_render_buffer_pivot, DVD_systems_internal_render_schedule);
+	DVD_systems_internal_schedule_dirty = false;
+}
+void DVD_systems_run_update()
+{
+	DVD_systems_internal_try_build_schedules();
+	for (size_t s = 0; s < DVD_systems_internal_update_buffer_pivot; s++) {
+		// A system changed the registration, the rest of the schedule is stale
+		if (DVD_systems_internal_schedule_dirty) {
+			break;
+		}
+		size_t i = DVD_systems_internal_update_schedule[s];
+		DVD_PROFILE_SYSTEM_BEGIN(sample);
+		for (int j = 0; j < DVD_entities_used_pivot; j++) {
+			const DVD_entity e = DVD_entities_used[j];
+			DVD_PROFILE_VISIT(sample);
+			if (DVD_signature_entity_fulfils(e, &DVD_systems_internal_update_signatures[i])) {
+				DVD_PROFILE_MATCH(sample);
+				DVD_PROFILE_CALL(sample);
+				DVD_systems_internal_update_buffer[i](e);
+			}
+		}
+		DVD_PROFILE_SYSTEM_END(sample, DVD_systems_internal_update_buffer[i], DVD_systems_internal_update_names[i], "update");
+	}
+}
+void DVD_systems_run_render()
+{
+	DVD_systems_internal_try_build_schedules();
+	const DVD_entity* entities = DVD_entities_used;
+	size_t entity_count = DVD_entities_used_pivot;
+	if (DVD_systems_internal_render_visibility != nullptr) {
+		DVD_filter visible = DVD_systems_internal_render_visibility();
+		// Out of frame memory, drawing everything is still correct
+		if (visible.list != nullptr) {
+			entities = visible.list;
+			entity_count = visible.count;
+		}
+	}
+	for (size_t s = 0; s < DVD_systems_internal_render_buffer_pivot; s++) {
+		if (DVD_systems_internal_schedule_dirty) {
+			break;
+		}
+		size_t i = DVD_systems_internal_render_schedule[s];
+		DVD_PROFILE_SYSTEM_BEGIN(sample);
+		for (size_t j = 0; j < entity_count; j++) {
+			const DVD_entity e = entities[j];
+			DVD_PROFILE_VISIT(sample);
+			if (DVD_signature_entity_fulfils(e, &DVD_systems_internal_render_signatures[i])) {
+				DVD_PROFILE_MATCH(sample);
+				DVD_PROFILE_CALL(sample);
+				DVD_systems_internal_render_buffer[i](e);
+			}
+		}
+		DVD_PROFILE_SYSTEM_END(sample, DVD_systems_internal_render_buffer[i], DVD_systems_internal_render_names[i], "render");
+	}
+}
@@ -1,8 +1,33 @@
 
 #pragma once
 #include "SDL/SDL_rect.h"
+#include "asset_registry.h"
+#include "atlas.h"
+#include "camera.h"
+#include "frame_capture.h"
+#include "frame_pacer.h"
 
 struct SDL_Texture;
+struct tilemap;
+struct texture_asset;
+struct font_asset;
+
+using texture_handle = asset_handle<texture_asset>;
+using font_handle = asset_handle<font_asset>;
+
+// Layers are drawn bottom to top, 0 - 255
+#define DEFAULT_DRAW_LAYER 128
+
+enum render_backend
+{
+	// Whatever SDL_CreateRenderer picks for the window, usually the GPU
+	RENDER_BACKEND_HARDWARE,
+	// Frames are drawn on the CPU into a framebuffer, sprites go through software_blit, shapes through SDL's software renderer
+	RENDER_BACKEND_SOFTWARE,
+	// The software backend without a window, SDL runs on the dummy video driver so no display is needed
+	// Frames only exist in the framebuffer, get them out with capture_next_frame and the frame hash
+	RENDER_BACKEND_HEADLESS
+};
 
 struct SDL_FCircle
 {
@@ -27,21 +52,84 @@ bool SDL_IntersectFCircleFCapsule(const SDL_FCircle& a, const SDL_FHorizontalCap
 
 namespace engine
 {
-	bool load_texture(const char* path, SDL_Texture*& out_texture);
-	void load_font(const char* path);
-	void initialise(int width, int height);
+	// A texture of its own outside the atlas, decoded on a loader thread and drawn as nothing until it is in
+	// Every load of a path is a reference on the same texture, a released texture stays loaded until the budget needs it
+	texture_handle load_texture(const char* path);
+	void release_texture(texture_handle texture);
+	bool is_loaded(texture_handle texture);
+	// Bytes of texture memory, textures nobody references are unloaded least recently released first once it is exceeded
+	void set_texture_budget(size_t bytes);
+	size_t get_texture_memory();
+	// The font is baked into a distance field once on a loader thread, cache_path keeps the bake on disk between runs
+	// Fonts are shared by path like textures, the first one loaded is what draw_text uses until set_font
+	font_handle load_font(const char* path, const char* cache_path = nullptr);
+	// Unloaded once the last reference is released, glyphs already resolved stay in the atlas
+	void release_font(font_handle font);
+	void set_font(font_handle font);
+	// worker_threads fixes the size of the job system pool, -1 picks it from the hardware
+	// threaded_rendering submits and presents each frame on a render thread while the next one is simulated
+	void initialise(int width, int height, int worker_threads = -1, bool threaded_rendering = true, render_backend backend = RENDER_BACKEND_HARDWARE);
+	void shutdown();
+	// initialise only starts SDL's video and events, other subsystems (SDL_INIT_AUDIO, SDL_INIT_GAMECONTROLLER, ...) start here on first use
+	bool require_subsystems(Uint32 sdl_flags);
 	void load_entities_texture(const char* path);
 	void load_tiles_texture(const char* path);
+	// Packs the image into the shared sprite atlas, draw_sprite src rects are relative to the image
+	// A path already in the atlas gives its handle again, sheets stay for as long as the atlas does
+	atlas_handle load_sprite_sheet(const char* path);
+	// Same, decoded on a loader thread, the handle can be drawn with right away and shows nothing until the image is in
+	// The entity and tiles textures and the font load this way as well
+	atlas_handle load_sprite_sheet_async(const char* path);
+	// A pack made by tools/asset_packer, images and fonts in it are loaded from the mapped pack without decoding
+	// Open it right after initialise, before anything it has is loaded from the loose files
+	// False without a word when there is no pack, only a pack that is there but broken gets reported
+	bool open_asset_pack(const char* path);
+	// Watches every loaded image on disk and swaps it in again at a frame boundary when it is written, handles stay valid
+	// Linux only (inotify), does nothing elsewhere
+	void set_hot_reload(bool enabled);
+	// Blocks until everything loading is in, for when a level should not start with placeholders
+	void wait_for_loads();
+	int get_loads_pending();
 	void set_entity_source_size(int width, int height);
 	void set_tile_source_size(int width, int height);
 	
+	// Every draw call after these goes into that layer and depth, layers decide what ends up on top,
+	// depth (0 - 65535) only orders draws sharing a texture inside a layer, so batches stay intact
+	void set_draw_layer(int layer);
+	void set_draw_depth(int depth);
+	// Every draw call is in world space, position is the world point drawn at the top left of the screen
+	void set_camera(const SDL_FPoint& position, float zoom = 1.0f);
+	const camera& get_camera();
+
 	void draw_text(const char* text, const SDL_FRect& dst);
+	void draw_text(const char* text, const SDL_FPoint& position, float pixel_height, SDL_Colour colour);
 	void draw_entity(const SDL_Point& sprite_index, const SDL_FRect& dst);
 	void draw_tile(const SDL_Point& sprite_index, const SDL_FRect& dst);
+	// Tiles come from the tiles texture, chunks under the camera are drawn as one sprite each and baked first when they changed
+	void draw_tilemap(tilemap& map);
+	void draw_sprite(atlas_handle sheet, const SDL_Rect& src, const SDL_FRect& dst);
+	void draw_texture(texture_handle texture, const SDL_Rect& src, const SDL_FRect& dst);
 	void draw_rect(const SDL_FRect& rect, SDL_Colour colour);
+	void fill_rect(const SDL_FRect& rect, SDL_Colour colour);
 	void draw_circle(const SDL_FCircle& circle, SDL_Colour colour);
+	void fill_circle(const SDL_FCircle& circle, SDL_Colour colour);
 	void draw_capsule(const SDL_FHorizontalCapsule& capsule, SDL_Colour colour);
 	void draw_line(const SDL_FPoint a, const SDL_FPoint b, SDL_Colour colour);
 	void render_clear();
+	// Hands the frame to the render thread, returns without waiting for it to be presented but paced by the frame pacing mode
 	void render_present();
+	// Vsync falls back to a target of the display refresh rate when the backend can not wait for the display
+	void set_frame_pacing(frame_pacing mode, double target_fps = 60.0);
+	// Only the parts of the screen whose draw calls changed since the last frame get drawn and presented,
+	// frames where nothing changed are skipped entirely, debug shapes make the whole frame count as changed
+	void set_dirty_rendering(bool enabled);
+	// The next frame is drawn whole, for when the window or the render targets lost what was on them
+	void invalidate_frame();
+
+	// The frame handed over by the next render_present is saved to path, the hardware backend reads it back from the GPU for that
+	void capture_next_frame(const char* path, capture_format format = CAPTURE_PNG);
+	// Hashes every presented frame while on, costs a read back per frame on the hardware backend
+	void set_frame_hashing(bool enabled);
+	// Waits for the frame in flight, 0 when hashing is off
+	Uint64 get_frame_hash();
 }
\ No newline at end of file
@@ -0,0 +1,17 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Tells which watched files were written on disk, inotify on Linux, everywhere else nothing is ever reported
+struct file_watcher
+{
+	// False when the platform or the system can not watch files
+	static bool initialise();
+	static void shutdown();
+	static bool is_running();
+
+	// Watches the directory the file is in, so editors that save by replacing the file are seen as well
+	static void watch(const char* path);
+	// Never blocks, paths come out the way they were given to watch and once each however often they were written
+	static void poll(std::vector<std::string>& out_changed);
+};
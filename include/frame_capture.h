@@ -0,0 +1,19 @@
+#pragma once
+#include "SDL/SDL_stdinc.h"
+
+struct SDL_Surface;
+
+enum capture_format
+{
+	CAPTURE_PNG,
+	// RGBA32 pixels row after row with no header and no padding, width * height * 4 bytes
+	CAPTURE_RAW
+};
+
+// Turns frames into something tests can compare, a hash for quick checks and files for golden images
+struct frame_capture
+{
+	// 64 bit FNV-1a over the visible pixels only, row padding never changes the hash
+	static Uint64 hash(const SDL_Surface* frame);
+	static bool save(SDL_Surface* frame, const char* path, capture_format format);
+};
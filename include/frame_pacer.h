@@ -0,0 +1,43 @@
+#pragma once
+#include <stddef.h>
+
+enum frame_pacing
+{
+	// As fast as the loop goes
+	FRAME_PACING_UNCAPPED,
+	// Presenting waits for the display, the pacer only measures, frames that were not presented wait a refresh here instead
+	FRAME_PACING_VSYNC,
+	// Sleeps most of the way to the next frame and spins the rest, frames start on time without burning a core
+	FRAME_PACING_TARGET
+};
+
+// Paces the main loop and keeps frame time statistics for the last window frames
+struct frame_pacer
+{
+	static constexpr size_t window = 120;
+
+	struct stats
+	{
+		size_t samples;
+		double average_ms;
+		double min_ms;
+		double max_ms;
+		// Standard deviation of the frame time
+		double deviation_ms;
+		// How far from its deadline a frame was let go, target mode only
+		double average_jitter_ms;
+		double max_jitter_ms;
+		// Per frame, time handed back to the OS and time spent spinning, target mode only
+		double average_sleep_ms;
+		double average_spin_ms;
+	};
+
+	// In vsync mode target_fps is the refresh rate of the display
+	static void set_mode(frame_pacing mode, double target_fps = 60.0);
+	static frame_pacing get_mode();
+	static double get_target_fps();
+	// Once per frame, in target mode it returns when the next frame is due
+	static void end_frame(bool presented = true);
+	static stats get_stats();
+	static void print();
+};
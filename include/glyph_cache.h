@@ -0,0 +1,29 @@
+#pragma once
+#include <unordered_map>
+#include "atlas.h"
+
+struct render_queue;
+struct sdf_font;
+
+// Resolves glyphs out of an SDF font into the sprite atlas, once per size out of a fixed set, text is then just sprites in the render queue
+struct glyph_cache
+{
+	void create(const sdf_font* font, texture_atlas* atlas);
+	void destroy();
+
+	// Width and height of the text at pixel_height, with kerning
+	SDL_FPoint measure(const char* text, float pixel_height) const;
+	// Stretches the text over dst, the same way the old surface per call version did
+	void draw(const char* text, const SDL_FRect& dst, SDL_Colour colour, render_queue& queue, int layer, int depth);
+	// Natural proportions, position is the top left of the line
+	void draw(const char* text, const SDL_FPoint& position, float pixel_height, SDL_Colour colour, render_queue& queue, int layer, int depth);
+
+private:
+	atlas_handle get(unsigned char character, int pixel_height);
+	void draw_scaled(const char* text, const SDL_FPoint& position, float pixel_height, float stretch_x, float stretch_y, SDL_Colour colour, render_queue& queue, int layer, int depth);
+
+	const sdf_font* font{ nullptr };
+	texture_atlas* atlas{ nullptr };
+	// Keyed by resolved height << 8 | character, never more than the fixed set of sizes
+	std::unordered_map<int, atlas_handle> resolved;
+};
@@ -0,0 +1,33 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Work-stealing job system - every thread owns a deque, owners take from the back and idle threads steal from the front
+struct jobs
+{
+	using function = std::function<void()>;
+	using range_function = std::function<void(size_t begin, size_t end)>;
+
+	// Counts unfinished jobs, a counter at zero means everything signalling it is done
+	struct counter
+	{
+		std::atomic<int> value{ 0 };
+		// Jobs depending on it sit here instead of in a queue, they get queued once it reaches zero
+		std::mutex mutex;
+		std::vector<function> waiting;
+	};
+
+	// worker_count < 0 picks one worker per hardware thread (minus the caller), 0 runs everything on the waiting thread
+	static void initialise(int worker_count = -1);
+	static void shutdown();
+	static int get_worker_count();
+
+	// signal is decremented once the job ran, the job will not start before dependency reaches zero
+	// The dependency is looked at here, jobs signalling it have to be run before the jobs depending on it
+	static void run(const function& job, counter* signal = nullptr, counter* dependency = nullptr);
+	// Executes other jobs while waiting, so it is safe to call from inside a job
+	static void wait(counter* c);
+	static void parallel_for(size_t count, size_t batch_size, const range_function& body);
+};
@@ -0,0 +1,63 @@
+#pragma once
+#include <stddef.h>
+
+// Profiling is only compiled into debug builds, release builds (NDEBUG) turn every hook into nothing
+#if !defined(NDEBUG) && !defined(DVD_PROFILING_DISABLED)
+#define DVD_PROFILING
+#endif
+
+#ifdef DVD_PROFILING
+struct profiler
+{
+	// Amount of samples each system keeps around for its averages
+	static constexpr size_t window = 120;
+
+	struct sample
+	{
+		unsigned long long start;
+		size_t visited;
+		size_t matched;
+		size_t calls;
+	};
+
+	struct stats
+	{
+		const char* name;
+		const char* category;
+		size_t samples;
+		double average_ms;
+		double max_ms;
+		double average_visited;
+		double average_matched;
+		double average_calls;
+	};
+
+	static unsigned long long now();
+	static void begin_frame();
+	static void end_frame();
+	static void record(const void* id, const char* name, const char* category, const sample& s);
+
+	static size_t count();
+	static bool get(size_t index, stats& out);
+	static bool find(const void* id, const char* category, stats& out);
+	static void print();
+	// Writes the buffered events in the chrome://tracing JSON format
+	static bool dump_chrome_trace(const char* path);
+};
+
+#define DVD_PROFILE_FRAME_BEGIN() profiler::begin_frame()
+#define DVD_PROFILE_FRAME_END() profiler::end_frame()
+#define DVD_PROFILE_SYSTEM_BEGIN(s) profiler::sample s{ profiler::now(), 0, 0, 0 }
+#define DVD_PROFILE_VISIT(s) s.visited += 1
+#define DVD_PROFILE_MATCH(s) s.matched += 1
+#define DVD_PROFILE_CALL(s) s.calls += 1
+#define DVD_PROFILE_SYSTEM_END(s, id, name, category) profiler::record((const void*)(id), name, category, s)
+#else
+#define DVD_PROFILE_FRAME_BEGIN()
+#define DVD_PROFILE_FRAME_END()
+#define DVD_PROFILE_SYSTEM_BEGIN(s)
+#define DVD_PROFILE_VISIT(s)
+#define DVD_PROFILE_MATCH(s)
+#define DVD_PROFILE_CALL(s)
+#define DVD_PROFILE_SYSTEM_END(s, id, name, category)
+#endif
@@ -0,0 +1,90 @@
+#pragma once
+#include <utility>
+#include <vector>
+#include "SDL/SDL_render.h"
+#include "blit_batch.h"
+#include "shape_batch.h"
+#include "sprite_batch.h"
+
+// Blend modes a command can ask for, kept to a handful so they fit in the sort key
+enum render_blend
+{
+	RENDER_BLEND_ALPHA,
+	RENDER_BLEND_ADD,
+	RENDER_BLEND_MOD,
+	RENDER_BLEND_NONE,
+	RENDER_BLEND_COUNT
+};
+
+enum render_command_type
+{
+	RENDER_SPRITE,
+	RENDER_RECT,
+	RENDER_FILL_RECT,
+	RENDER_LINE,
+	RENDER_CIRCLE,
+	RENDER_FILL_CIRCLE,
+	RENDER_CAPSULE
+};
+
+struct render_command
+{
+	render_command_type type;
+	SDL_Texture* texture;
+	SDL_Rect src;
+	// Sprite and rect: x y w h, line: a b, circle: x y radius, capsule: position size
+	SDL_FRect dst;
+	SDL_Colour colour;
+};
+
+// From the top bit down: layer (8), texture (16), blend (4), depth (16), submission index (20)
+// Layers decide what ends up on top, inside a layer commands are grouped by texture and blend mode so they batch,
+// depth orders commands sharing a texture and the submission index keeps ties in the order they were pushed
+typedef unsigned long long render_key;
+
+struct render_queue
+{
+	static constexpr int max_layer = 255;
+	static constexpr int max_depth = 65535;
+	static constexpr size_t max_commands = 1 << 20;
+
+	static render_key make_key(int layer, int texture_id, render_blend blend, int depth, size_t index);
+
+	void push_sprite(int layer, int depth, SDL_Texture* texture, const SDL_Rect& src, const SDL_FRect& dst, SDL_Colour colour = { 255, 255, 255, 255 }, render_blend blend = RENDER_BLEND_ALPHA);
+	void push_shape(int layer, int depth, render_command_type type, const SDL_FRect& data, SDL_Colour colour, render_blend blend = RENDER_BLEND_ALPHA);
+
+	// Sorts the queue, draws it with as few state changes as possible and empties it
+	// With clips only the pixels inside those rects are touched, once per rect, so they should not overlap
+	// With a framebuffer the renderer has to be a software renderer drawing into it, sprites whose texture has its pixels
+	// on the CPU (software_blit::add_pixels) are then blitted straight into the framebuffer and skip the renderer,
+	// runs of those blits are drawn in screen tiles spread over the job system
+	void submit(SDL_Renderer* renderer, SDL_Surface* framebuffer = nullptr, const SDL_Rect* clips = nullptr, int clip_count = 0);
+	void clear();
+	size_t size() const;
+	// Only until submit, in the order the commands were pushed, the key without its submission index and texture id
+	// (ids only mean something within one frame, the command has the texture itself)
+	const render_command& get_command(size_t index) const;
+	render_key get_key(size_t index) const;
+
+private:
+	void push(render_key key_without_index, const render_command& command);
+	int get_texture_id(SDL_Texture* texture);
+	void sort();
+	void flush_batches(SDL_Renderer* renderer);
+	void draw(SDL_Renderer* renderer, SDL_Surface* framebuffer, const SDL_Rect* clip);
+
+	std::vector<render_command> commands;
+	std::vector<render_key> keys;
+	std::vector<render_key> scratch;
+	// The id in the key is the index + 1, 0 is left for shapes, handed out in the order textures show up
+	// Forgotten on clear so textures that are gone never pile up, the capacity stays so pushing never allocates
+	// A frame only sees a handful of textures, with the last one looked up checked first
+	std::vector<std::pair<SDL_Texture*, int>> texture_ids;
+	size_t last_texture{ 0 };
+	// Dropped commands are reported once per frame, not once per command
+	bool reported_full{ false };
+
+	sprite_batch sprites;
+	shape_batch shapes;
+	blit_batch blits;
+};
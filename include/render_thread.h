@@ -0,0 +1,28 @@
+#pragma once
+#include <functional>
+
+struct SDL_Renderer;
+struct SDL_Surface;
+struct SDL_Window;
+
+// Owns the renderer on a thread of its own, the main thread records a frame while the previous one is submitted and presented
+// Every SDL_Renderer and SDL_Texture call has to go through here once it is running
+struct render_thread
+{
+	using task = std::function<void()>;
+
+	// threaded false keeps the renderer on the calling thread and runs everything inline, for platforms that need it there
+	static SDL_Renderer* start(SDL_Window* window, unsigned int renderer_flags, bool threaded = true);
+	// Same, with SDL's software renderer drawing into the surface instead of a window
+	static SDL_Renderer* start(SDL_Surface* framebuffer, bool threaded = true);
+	// Waits for the frame in flight, destroys the renderer on its own thread and joins
+	static void stop();
+	static bool is_running();
+	static bool is_render_thread();
+
+	// Runs the task on the render thread and waits for it, runs inline from the render thread itself or when not threaded
+	static void call(const task& t);
+	// Hands a recorded frame over, waits for the previous one first so at most one frame is in flight
+	static void submit_frame(const task& frame);
+	static void wait_idle();
+};
@@ -0,0 +1,52 @@
+#pragma once
+#include <stddef.h>
+#include <vector>
+#include "SDL/SDL_stdinc.h"
+
+struct SDL_Surface;
+
+// Signed distance field glyphs baked once from a TTF, any pixel size is resolved from the same bake
+// Covers Latin-1 (32 - 255), which is everything the engine's text ever went through
+struct sdf_font
+{
+	static constexpr int first_character = 32;
+	static constexpr int character_count = 256 - first_character;
+
+	// Written to the cache as is, fixed width types so a cache reads the same on every platform
+	struct glyph
+	{
+		Sint32 width, height; // Field size, includes the spread on every side
+		Sint32 offset_x;      // From the pen to the left edge of the field
+		Sint32 advance;
+		Uint64 pixels;        // Offset into the field buffer
+	};
+
+	// Rasterises every glyph at base_size points and builds the fields, spread is in base pixels
+	bool bake(const char* ttf_path, int base_size = 72, int spread = 8);
+	bool load_cache(const char* path, const char* ttf_path);
+	bool save_cache(const char* path, const char* ttf_path) const;
+	// The cache file in memory, for asset packs, source_size is the size of the TTF and -1 skips checking it
+	bool read_cache(const void* data, size_t size, long source_size = -1);
+	// Everything read_cache checks without reading it, glyphs included, for whatever hands caches around
+	static bool validate_cache(const void* data, size_t size, long source_size = -1);
+	bool write_cache(std::vector<unsigned char>& out_cache, long source_size = -1) const;
+	bool is_baked() const;
+	// Bytes of the fields and the kerning table
+	size_t get_memory() const;
+
+	const glyph* get(unsigned char character) const;
+	int get_kerning(unsigned char previous, unsigned char character) const;
+	int get_base_height() const;
+	int get_spread() const;
+
+	// Alpha coverage of a glyph at pixel_height, white RGBA32, caller frees it
+	SDL_Surface* resolve(unsigned char character, float pixel_height) const;
+
+private:
+	int base_height{ 0 };
+	int spread{ 0 };
+	glyph glyphs[character_count]{};
+	std::vector<Sint16> kerning;
+	// 128 is the outline, brighter is inside, 0 and 255 are spread base pixels away from it
+	std::vector<unsigned char> fields;
+};
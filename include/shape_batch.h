@@ -0,0 +1,31 @@
+#pragma once
+#include <vector>
+#include "SDL/SDL_render.h"
+
+// Collects the outline and filled shapes of a frame and draws all of them in one SDL_RenderGeometry call
+// Outlines are one pixel wide quads per segment, so everything keeps the order it was added in and the draw colour is never touched
+struct shape_batch
+{
+	void add_line(const SDL_FPoint& a, const SDL_FPoint& b, SDL_Colour colour);
+	void add_rect(const SDL_FRect& rect, SDL_Colour colour);
+	void add_circle(const SDL_FPoint& center, float radius, SDL_Colour colour);
+	// Two half circles joined by straight lines, size.x is the distance between the centers, size.y the radius
+	void add_capsule(const SDL_FPoint& center, const SDL_FPoint& size, SDL_Colour colour);
+
+	void fill_rect(const SDL_FRect& rect, SDL_Colour colour);
+	void fill_circle(const SDL_FPoint& center, float radius, SDL_Colour colour);
+
+	void flush(SDL_Renderer* renderer);
+	bool is_empty() const;
+
+private:
+	void add_arc(const SDL_FPoint& center, float radius, int first_step, int steps, int stride);
+	void add_segment(const SDL_FPoint& a, const SDL_FPoint& b, SDL_Colour colour);
+	void add_polyline(const SDL_FPoint* polyline, size_t count, SDL_Colour colour);
+
+	// Scratch for the points of an outline before they become quads
+	std::vector<SDL_FPoint> points;
+	// Vertices stay allocated between frames
+	std::vector<SDL_Vertex> vertices;
+	std::vector<int> indices;
+};
@@ -0,0 +1,38 @@
+#pragma once
+#include "SDL/SDL_blendmode.h"
+#include "SDL/SDL_pixels.h"
+#include "SDL/SDL_rect.h"
+
+struct SDL_Surface;
+struct SDL_Texture;
+
+enum blit_filter
+{
+	BLIT_FILTER_NEAREST,
+	BLIT_FILTER_BILINEAR
+};
+
+enum blit_simd
+{
+	BLIT_SIMD_SCALAR,
+	BLIT_SIMD_SSE2,
+	BLIT_SIMD_AVX2
+};
+
+// CPU sprite blitter for the software backend, draws RGBA32 surfaces into an RGBA32 framebuffer
+// Every instruction set does the same integer maths, so the scalar, SSE2 and AVX2 paths give the exact same pixels
+struct software_blit
+{
+	// Picked from the CPU the first time it is asked for, set_simd is for benchmarks and falls back to what the CPU has
+	static blit_simd get_simd();
+	static void set_simd(blit_simd simd);
+
+	// Covers the pixels whose centers are inside dst, like the GPU does, colour modulates the source and blend follows SDL's blend modes
+	static void draw(SDL_Surface* target, const SDL_Rect& clip, const SDL_Surface* source, const SDL_Rect& src, const SDL_FRect& dst, SDL_Colour colour, SDL_BlendMode blend, blit_filter filter);
+
+	// Textures whose pixels are kept around on the CPU, the software backend reads them instead of going through the renderer
+	// The surface has to stay alive and RGBA32 until it is removed again
+	static void add_pixels(SDL_Texture* texture, SDL_Surface* pixels);
+	static void remove_pixels(SDL_Texture* texture);
+	static SDL_Surface* find_pixels(SDL_Texture* texture);
+};
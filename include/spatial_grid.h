@@ -0,0 +1,46 @@
+#pragma once
+#include <unordered_map>
+#include <vector>
+#include "SDL/SDL_rect.h"
+
+// Uniform grid over world space, ids are small integers (entities) and every id sits in each cell its bounds touch
+// Moving within the same cells only rewrites the bounds, so static things cost nothing to keep up to date
+struct spatial_grid
+{
+	void create(float cell_size);
+	void clear();
+
+	void update(size_t id, const SDL_FRect& bounds);
+	void remove(size_t id);
+	// Writes every id whose bounds overlap area into out, each id once, in ascending order, and returns how many
+	// out needs room for get_count() ids, so it can come out of an arena sized before the query
+	size_t query(const SDL_FRect& area, size_t* out);
+	// Ids currently in the grid
+	size_t get_count() const;
+
+private:
+	struct cell_range
+	{
+		int min_x, min_y, max_x, max_y;
+	};
+
+	struct entry
+	{
+		bool inserted;
+		SDL_FRect bounds;
+		cell_range cells;
+		unsigned int query_stamp;
+	};
+
+	cell_range get_cells(const SDL_FRect& bounds) const;
+	static long long get_key(int x, int y);
+	void insert_cells(size_t id, const cell_range& cells);
+	void remove_cells(size_t id, const cell_range& cells);
+
+	float cell_size{ 64.0f };
+	float inverse_cell_size{ 1.0f / 64.0f };
+	std::unordered_map<long long, std::vector<size_t>> cells;
+	std::vector<entry> entries;
+	size_t inserted_count{ 0 };
+	unsigned int query_stamp{ 0 };
+};
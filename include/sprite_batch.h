@@ -0,0 +1,26 @@
+#pragma once
+#include <vector>
+#include "SDL/SDL_render.h"
+
+// Collects textured quads per texture and submits every texture with a single SDL_RenderGeometry call
+// Quads of the same texture keep their order, textures get flushed in the order they were first used
+struct sprite_batch
+{
+	struct bucket
+	{
+		SDL_Texture* texture;
+		SDL_FPoint inverse_size;
+		size_t first_use;
+		std::vector<SDL_Vertex> vertices;
+	};
+
+	void add(SDL_Texture* texture, const SDL_Rect& src, const SDL_FRect& dst, SDL_Colour colour = { 255, 255, 255, 255 });
+	void flush(SDL_Renderer* renderer);
+	bool is_empty() const;
+
+private:
+	// Buckets and their vectors stay alive between frames, so after warm up a frame allocates nothing
+	std::vector<bucket> buckets;
+	size_t used_buckets{ 0 };
+	size_t quads{ 0 };
+};
@@ -0,0 +1,31 @@
+#pragma once
+#include <stddef.h>
+#include <vector>
+
+// Where the time from engine::initialise to the first frame with every startup asset in it goes
+// Phases are wall time on the thread that measured them, loader threads measure theirs at the same time as the main thread
+struct startup_timer
+{
+	struct phase
+	{
+		const char* name;
+		// Since begin, when the phase first started and when it last ended
+		double start_ms;
+		double end_ms;
+		// Summed over every time it was measured, more than end - start when it ran on several threads at once
+		double total_ms;
+		size_t count;
+	};
+
+	static void begin();
+	// Takes start from now(), safe from any thread, every measurement with the same name adds to the same phase
+	static void record(const char* name, unsigned long long start);
+	// Startup is over, the report is printed once
+	static void finish();
+	static bool is_finished();
+	static unsigned long long now();
+
+	static std::vector<phase> get_phases();
+	static double get_total_ms();
+	static void print();
+};
@@ -0,0 +1,57 @@
+#pragma once
+#include "SDL/SDL_rect.h"
+
+struct arena;
+struct SDL_Texture;
+
+// Tiles in a grid, split into square chunks that the engine bakes into render targets
+// A chunk is only baked again after one of its tiles changed, a static level is a handful of copies per frame
+struct tilemap
+{
+	static constexpr int chunk_tiles = 16;
+
+	struct chunk
+	{
+		SDL_Texture* texture;
+		bool dirty;
+		int used_tiles;
+	};
+
+	// tile_size is the size of one tile in the world, origin the world position of the top left tile
+	// Tiles and chunks come out of memory, destroy before it is reset (a level uses the scene arena)
+	void create(int columns, int rows, const SDL_FPoint& tile_size, const SDL_FPoint& origin, arena& memory);
+	// Chunk textures are released on the render thread
+	void destroy();
+
+	// A negative sprite index clears the cell
+	void set(int column, int row, const SDL_Point& sprite_index);
+	SDL_Point get(int column, int row) const;
+	bool is_empty(int column, int row) const;
+	bool to_cell(const SDL_FPoint& world, SDL_Point& out_cell) const;
+	// Marks every chunk for baking, the contents of render targets are gone after SDL_RENDER_TARGETS_RESET
+	void invalidate();
+
+	int get_columns() const;
+	int get_rows() const;
+	int get_chunk_columns() const;
+	int get_chunk_rows() const;
+	chunk& get_chunk(int chunk_column, int chunk_row);
+	SDL_FRect get_chunk_bounds(int chunk_column, int chunk_row) const;
+	SDL_FRect get_bounds() const;
+	SDL_FPoint get_tile_size() const;
+
+	// The version of the tiles sheet the chunks were baked from, the engine bakes them again after the sheet is reloaded
+	unsigned int baked_sheet_version{ 0 };
+
+private:
+	bool is_inside(int column, int row) const;
+
+	int columns{ 0 };
+	int rows{ 0 };
+	int chunk_columns{ 0 };
+	int chunk_rows{ 0 };
+	SDL_FPoint tile_size{ 0.0f, 0.0f };
+	SDL_FPoint origin{ 0.0f, 0.0f };
+	SDL_Point* tiles{ nullptr };
+	chunk* chunks{ nullptr };
+};
@@ -0,0 +1,68 @@
+#include "arena.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static arena frame_arena;
+static arena scene_arena;
+
+void arena::create(size_t size)
+{
+	destroy();
+	memory = (unsigned char*)malloc(size);
+	capacity = memory != nullptr ? size : 0;
+	offset = 0;
+	peak = 0;
+}
+
+void arena::destroy()
+{
+	free(memory);
+	memory = nullptr;
+	capacity = 0;
+	offset = 0;
+}
+
+void* arena::allocate(size_t size, size_t alignment)
+{
+	size_t current = offset.load();
+	size_t aligned;
+	do {
+		uintptr_t address = (uintptr_t)memory + current;
+		aligned = current + ((alignment - (address % alignment)) % alignment);
+		if (aligned + size > capacity) {
+			printf("Arena out of memory: wanted %zu bytes, %zu of %zu in use\n", size, current, capacity);
+			return nullptr;
+		}
+	} while (!offset.compare_exchange_weak(current, aligned + size));
+	return memory + aligned;
+}
+
+void arena::reset()
+{
+	size_t used = offset.exchange(0);
+	peak = used > peak ? used : peak;
+}
+
+arena& arena::frame()
+{
+	return frame_arena;
+}
+
+arena& arena::scene()
+{
+	return scene_arena;
+}
+
+void arena::initialise(size_t frame_capacity, size_t scene_capacity)
+{
+	frame_arena.create(frame_capacity);
+	scene_arena.create(scene_capacity);
+}
+
+void arena::shutdown()
+{
+	frame_arena.destroy();
+	scene_arena.destroy();
+}
@@ -0,0 +1,119 @@
+#include "asset_loader.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct pending_load
+{
+	asset_loader::task work;
+	asset_loader::task done;
+};
+
+static std::vector<std::thread> threads;
+static bool stopping{ false };
+// Loads that were handed over and whose done has not run yet
+static int pending{ 0 };
+
+static std::mutex mutex;
+// Wakes the loader threads up, for new work and stopping
+static std::condition_variable wake;
+// Wakes up the main thread waiting in wait_all
+static std::condition_variable finished;
+static std::deque<pending_load> queued;
+static std::vector<asset_loader::task> completed;
+
+static void loop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		wake.wait(lock, []() { return stopping || !queued.empty(); });
+		if (queued.empty()) {
+			break;
+		}
+		pending_load l = std::move(queued.front());
+		queued.pop_front();
+		lock.unlock();
+		l.work();
+		lock.lock();
+		completed.push_back(std::move(l.done));
+		finished.notify_all();
+	}
+}
+
+void asset_loader::initialise(int thread_count)
+{
+	stopping = false;
+	for (int i = 0; i < thread_count; i++) {
+		threads.emplace_back(loop);
+	}
+}
+
+void asset_loader::shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	// The threads drain the queue before they leave
+	for (auto& t : threads) {
+		t.join();
+	}
+	threads.clear();
+	poll();
+}
+
+void asset_loader::load(const task& work, const task& done)
+{
+	if (threads.empty()) {
+		work();
+		std::lock_guard<std::mutex> lock(mutex);
+		pending += 1;
+		completed.push_back(done);
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pending += 1;
+		queued.push_back({ work, done });
+	}
+	wake.notify_one();
+}
+
+void asset_loader::poll()
+{
+	std::vector<task> ready;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		ready.swap(completed);
+	}
+	// Done tasks are free to start new loads
+	for (auto& t : ready) {
+		t();
+	}
+	std::lock_guard<std::mutex> lock(mutex);
+	pending -= (int)ready.size();
+}
+
+void asset_loader::wait_all()
+{
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			finished.wait(lock, []() { return !completed.empty() || pending == 0; });
+			if (pending == 0) {
+				return;
+			}
+		}
+		poll();
+	}
+}
+
+int asset_loader::get_pending_count()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return pending;
+}
@@ -0,0 +1,171 @@
+#include "asset_pack.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <SDL/SDL.h>
+#include "sdf_font.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// The view keeps the file mapped on its own, the handles are closed right away on both platforms
+// out_missing tells a file that is not there apart from one that could not be mapped
+static const unsigned char* map_file(const char* path, size_t& out_size, bool& out_missing)
+{
+	out_size = 0;
+	out_missing = false;
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		DWORD error = GetLastError();
+		out_missing = error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND;
+		return nullptr;
+	}
+	LARGE_INTEGER size;
+	HANDLE mapping = nullptr;
+	if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	}
+	CloseHandle(file);
+	if (mapping == nullptr) {
+		return nullptr;
+	}
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (view == nullptr) {
+		return nullptr;
+	}
+	out_size = (size_t)size.QuadPart;
+	return (const unsigned char*)view;
+#else
+	int file = ::open(path, O_RDONLY);
+	if (file < 0) {
+		out_missing = errno == ENOENT || errno == ENOTDIR;
+		return nullptr;
+	}
+	struct stat info;
+	void* view = MAP_FAILED;
+	if (fstat(file, &info) == 0 && info.st_size > 0) {
+		view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	}
+	::close(file);
+	if (view == MAP_FAILED) {
+		return nullptr;
+	}
+	out_size = (size_t)info.st_size;
+	return (const unsigned char*)view;
+#endif
+}
+
+static void unmap_file(const unsigned char* view, size_t size)
+{
+#ifdef _WIN32
+	(void)size;
+	UnmapViewOfFile(view);
+#else
+	munmap((void*)view, size);
+#endif
+}
+
+bool asset_pack::open(const char* path)
+{
+	close();
+	bool missing;
+	mapped = map_file(path, mapped_size, missing);
+	if (mapped == nullptr) {
+		// Packs are optional, only one that is there and still does not map is worth a word
+		if (!missing) {
+			printf("Could not map asset pack %s\n", path);
+		}
+		return false;
+	}
+	if (!validate()) {
+		printf("Asset pack %s is broken or from another version\n", path);
+		close();
+		return false;
+	}
+	return true;
+}
+
+void asset_pack::close()
+{
+	if (mapped != nullptr) {
+		unmap_file(mapped, mapped_size);
+	}
+	mapped = nullptr;
+	mapped_size = 0;
+	entries.clear();
+}
+
+bool asset_pack::is_open() const
+{
+	return mapped != nullptr;
+}
+
+// Everything is checked once here, so the lookups after can trust the offsets
+bool asset_pack::validate()
+{
+	asset_pack_header header;
+	if (mapped_size < sizeof(header)) {
+		return false;
+	}
+	memcpy(&header, mapped, sizeof(header));
+	if (header.magic != ASSET_PACK_MAGIC || header.version != ASSET_PACK_VERSION
+		|| header.toc_offset % alignof(asset_pack_entry) != 0 || header.toc_offset > mapped_size
+		|| (mapped_size - header.toc_offset) / sizeof(asset_pack_entry) < header.entry_count) {
+		return false;
+	}
+	const asset_pack_entry* toc = (const asset_pack_entry*)(mapped + header.toc_offset);
+	for (Uint32 i = 0; i < header.entry_count; i++) {
+		const asset_pack_entry& e = toc[i];
+		if (memchr(e.name, 0, sizeof(e.name)) == nullptr || e.offset > mapped_size || e.size > mapped_size - e.offset) {
+			return false;
+		}
+		// Surfaces point straight at the pixels, the packer aligns them and so should anything else writing packs
+		// In 64 bits, a width near the top of Sint32 must not wrap its row size around to a tiny pitch
+		if (e.type == ASSET_PACK_IMAGE && (e.format != SDL_PIXELFORMAT_RGBA32 || e.width <= 0 || e.height <= 0
+			|| e.width > INT_MAX / 4 || e.height > INT_MAX / 4 || e.pitch <= 0 || e.pitch % 4 != 0
+			|| e.offset % ASSET_PACK_ALIGNMENT != 0 || (Uint64)e.pitch < (Uint64)e.width * 4 || (Uint64)e.pitch * (Uint64)e.height > e.size)) {
+			return false;
+		}
+		// The glyphs point into the fields, a broken one would have resolve read past the mapping
+		if (e.type == ASSET_PACK_FONT && !sdf_font::validate_cache(mapped + e.offset, (size_t)e.size)) {
+			return false;
+		}
+		if (e.type != ASSET_PACK_IMAGE && e.type != ASSET_PACK_FONT) {
+			return false;
+		}
+		entries[e.name] = &e;
+	}
+	return true;
+}
+
+const asset_pack_entry* asset_pack::find(const char* name) const
+{
+	auto found = entries.find(name);
+	return found != entries.end() ? found->second : nullptr;
+}
+
+const void* asset_pack::get_data(const asset_pack_entry& entry) const
+{
+	return mapped + entry.offset;
+}
+
+SDL_Surface* asset_pack::create_surface(const asset_pack_entry& entry) const
+{
+	if (entry.type != ASSET_PACK_IMAGE) {
+		return nullptr;
+	}
+	// SDL never writes through the pixels of a surface it is only reading from, the const goes for its signature
+	return SDL_CreateRGBSurfaceWithFormatFrom((void*)get_data(entry), entry.width, entry.height, 32, entry.pitch, SDL_PIXELFORMAT_RGBA32);
+}
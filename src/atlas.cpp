@@ -0,0 +1,298 @@
+#include "atlas.h"
+#include "render_thread.h"
+#include "software_blit.h"
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_image.h>
+#include <stdio.h>
+
+void rect_packer::create(int width, int height)
+{
+	page_width = width;
+	page_height = height;
+	clear();
+}
+
+void rect_packer::clear()
+{
+	skyline.clear();
+	skyline.push_back({ 0, 0, page_width });
+}
+
+// Returns the height a rect would rest at when placed on node index, -1 when it does not fit there
+int rect_packer::fit(size_t index, int width, int height) const
+{
+	int x = skyline[index].x;
+	if (x + width > page_width) {
+		return -1;
+	}
+	int y = skyline[index].y;
+	int width_left = width;
+	for (size_t i = index; width_left > 0; i++) {
+		if (i >= skyline.size()) {
+			return -1;
+		}
+		y = SDL_max(y, skyline[i].y);
+		if (y + height > page_height) {
+			return -1;
+		}
+		width_left -= skyline[i].width;
+	}
+	return y;
+}
+
+bool rect_packer::pack(int width, int height, SDL_Point& out_position)
+{
+	size_t best_index = skyline.size();
+	int best_bottom = page_height + 1;
+	int best_width = page_width + 1;
+	for (size_t i = 0; i < skyline.size(); i++) {
+		int y = fit(i, width, height);
+		if (y < 0) {
+			continue;
+		}
+		if (y + height < best_bottom || (y + height == best_bottom && skyline[i].width < best_width)) {
+			best_index = i;
+			best_bottom = y + height;
+			best_width = skyline[i].width;
+		}
+	}
+	if (best_index == skyline.size()) {
+		return false;
+	}
+
+	out_position = { skyline[best_index].x, best_bottom - height };
+	skyline.insert(skyline.begin() + best_index, { out_position.x, best_bottom, width });
+
+	// Nodes under the new one get cut down or removed
+	for (size_t i = best_index + 1; i < skyline.size(); i++) {
+		const skyline_node& previous = skyline[i - 1];
+		skyline_node& node = skyline[i];
+		int previous_end = previous.x + previous.width;
+		if (node.x >= previous_end) {
+			break;
+		}
+		int shrink = previous_end - node.x;
+		node.x += shrink;
+		node.width -= shrink;
+		if (node.width > 0) {
+			break;
+		}
+		skyline.erase(skyline.begin() + i);
+		i--;
+	}
+
+	// Merge neighbours at the same height
+	for (size_t i = 0; i + 1 < skyline.size(); i++) {
+		if (skyline[i].y == skyline[i + 1].y) {
+			skyline[i].width += skyline[i + 1].width;
+			skyline.erase(skyline.begin() + i + 1);
+			i--;
+		}
+	}
+	return true;
+}
+
+void texture_atlas::create(SDL_Renderer* atlas_renderer, int atlas_page_size, int atlas_padding)
+{
+	destroy();
+	renderer = atlas_renderer;
+	page_size = atlas_page_size;
+	padding = atlas_padding;
+}
+
+void texture_atlas::destroy()
+{
+	std::vector<page> destroyed;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		destroyed.swap(pages);
+		regions.clear();
+	}
+	render_thread::call([&destroyed]() {
+		for (auto& p : destroyed) {
+			software_blit::remove_pixels(p.texture);
+			SDL_DestroyTexture(p.texture);
+		}
+	});
+	for (auto& p : destroyed) {
+		SDL_FreeSurface(p.pixels);
+	}
+}
+
+// Called without the lock held, the render thread might be waiting on it in upload while this waits on the render thread
+bool texture_atlas::create_page(int width, int height, page& out_page)
+{
+	page p;
+	p.pixels = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_RGBA32);
+	p.texture = nullptr;
+	render_thread::call([&]() {
+		p.texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, width, height);
+		if (p.texture != nullptr) {
+			SDL_SetTextureBlendMode(p.texture, SDL_BLENDMODE_BLEND);
+		}
+	});
+	if (p.pixels == nullptr || p.texture == nullptr) {
+		printf("Could not create atlas page: %s\n", SDL_GetError());
+		SDL_FreeSurface(p.pixels);
+		render_thread::call([&p]() {
+			SDL_DestroyTexture(p.texture);
+		});
+		return false;
+	}
+	p.packer.create(width, height);
+	// The software backend reads the page straight from here, added regions never overlap what is being drawn
+	software_blit::add_pixels(p.texture, p.pixels);
+	// Whole page once, so the texture never shows uninitialised memory
+	p.dirty = { 0, 0, width, height };
+	out_page = p;
+	return true;
+}
+
+bool texture_atlas::place(SDL_Surface* surface, atlas_region& out_region)
+{
+	if (surface == nullptr) {
+		return false;
+	}
+	SDL_Surface* converted = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0);
+	if (converted == nullptr) {
+		return false;
+	}
+
+	int width = converted->w + padding * 2;
+	int height = converted->h + padding * 2;
+	SDL_Point position;
+	std::unique_lock<std::mutex> lock(mutex);
+	size_t page_index = 0;
+	for (; page_index < pages.size(); page_index++) {
+		if (pages[page_index].packer.pack(width, height, position)) {
+			break;
+		}
+	}
+	if (page_index == pages.size()) {
+		// Oversized images get a page of their own
+		page created;
+		lock.unlock();
+		bool has_page = create_page(SDL_max(page_size, width), SDL_max(page_size, height), created);
+		lock.lock();
+		if (has_page) {
+			pages.push_back(created);
+		}
+		if (!has_page || !pages.back().packer.pack(width, height, position)) {
+			SDL_FreeSurface(converted);
+			return false;
+		}
+		page_index = pages.size() - 1;
+	}
+
+	page& p = pages[page_index];
+	SDL_Rect rect{ position.x + padding, position.y + padding, converted->w, converted->h };
+	SDL_SetSurfaceBlendMode(converted, SDL_BLENDMODE_NONE);
+	SDL_BlitSurface(converted, nullptr, p.pixels, &rect);
+	SDL_FreeSurface(converted);
+
+	if (SDL_RectEmpty(&p.dirty)) {
+		p.dirty = rect;
+	}
+	else {
+		SDL_UnionRect(&p.dirty, &rect, &p.dirty);
+	}
+
+	out_region = { p.texture, rect };
+	return true;
+}
+
+atlas_handle texture_atlas::add(SDL_Surface* surface)
+{
+	atlas_region region;
+	if (!place(surface, region)) {
+		return INVALID_ATLAS_HANDLE;
+	}
+	regions.push_back(region);
+	return (atlas_handle)regions.size() - 1;
+}
+
+atlas_handle texture_atlas::reserve()
+{
+	regions.push_back({ nullptr, { 0, 0, 0, 0 } });
+	return (atlas_handle)regions.size() - 1;
+}
+
+bool texture_atlas::fill(atlas_handle handle, SDL_Surface* surface)
+{
+	if (handle < 0 || handle >= (atlas_handle)regions.size()) {
+		return false;
+	}
+	return place(surface, regions[handle]);
+}
+
+atlas_handle texture_atlas::add(const char* path)
+{
+	SDL_Surface* surface = IMG_Load(path);
+	if (surface == nullptr) {
+		printf("Could not load %s: %s\n", path, IMG_GetError());
+		return INVALID_ATLAS_HANDLE;
+	}
+	atlas_handle handle = add(surface);
+	SDL_FreeSurface(surface);
+	return handle;
+}
+
+bool texture_atlas::replace(atlas_handle handle, SDL_Surface* surface)
+{
+	if (handle < 0 || handle >= (atlas_handle)regions.size() || surface == nullptr) {
+		return false;
+	}
+	atlas_region& region = regions[handle];
+	if (region.texture == nullptr || surface->w != region.rect.w || surface->h != region.rect.h) {
+		// The old space stays taken, the packer can not give it back
+		return place(surface, region);
+	}
+	SDL_Surface* converted = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0);
+	if (converted == nullptr) {
+		return false;
+	}
+	std::lock_guard<std::mutex> lock(mutex);
+	for (auto& p : pages) {
+		if (p.texture != region.texture) {
+			continue;
+		}
+		SDL_Rect rect = region.rect;
+		SDL_SetSurfaceBlendMode(converted, SDL_BLENDMODE_NONE);
+		SDL_BlitSurface(converted, nullptr, p.pixels, &rect);
+		if (SDL_RectEmpty(&p.dirty)) {
+			p.dirty = region.rect;
+		}
+		else {
+			SDL_UnionRect(&p.dirty, &region.rect, &p.dirty);
+		}
+	}
+	SDL_FreeSurface(converted);
+	return true;
+}
+
+const atlas_region* texture_atlas::get(atlas_handle handle) const
+{
+	if (handle < 0 || handle >= (atlas_handle)regions.size()) {
+		return nullptr;
+	}
+	return &regions[handle];
+}
+
+void texture_atlas::upload()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (auto& p : pages) {
+		if (SDL_RectEmpty(&p.dirty)) {
+			continue;
+		}
+		const Uint8* start = (const Uint8*)p.pixels->pixels + p.dirty.y * p.pixels->pitch + p.dirty.x * 4;
+		SDL_UpdateTexture(p.texture, &p.dirty, start, p.pixels->pitch);
+		p.dirty = { 0, 0, 0, 0 };
+	}
+}
+
+size_t texture_atlas::get_page_count() const
+{
+	return pages.size();
+}
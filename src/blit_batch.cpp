@@ -0,0 +1,99 @@
+#include "blit_batch.h"
+
+#include <SDL/SDL.h>
+#include "jobs.h"
+
+// Tiles handed to a job at once, small enough that a few crowded tiles do not leave the other workers idle
+#define TILES_PER_JOB 2
+
+void blit_batch::add(const SDL_Surface* source, const SDL_Rect& src, const SDL_FRect& dst, SDL_Colour colour, SDL_BlendMode blend, blit_filter filter)
+{
+	if (source == nullptr) {
+		return;
+	}
+	blits.push_back({ source, src, dst, colour, blend, filter });
+}
+
+// Counting sort of blit indices by tile, blits stay in submission order inside every tile
+void blit_batch::bin(int columns, int rows)
+{
+	size_t tile_count = (size_t)columns * rows;
+	tile_offsets.assign(tile_count + 1, 0);
+	tile_ranges.resize(blits.size());
+	for (size_t i = 0; i < blits.size(); i++) {
+		// A little wider than the pixels the blit covers, the tile clip takes care of the rest
+		const SDL_FRect& d = blits[i].dst;
+		int x0 = SDL_max(0, (int)SDL_floorf(d.x) / tile_size);
+		int y0 = SDL_max(0, (int)SDL_floorf(d.y) / tile_size);
+		int x1 = SDL_min(columns - 1, (int)SDL_ceilf(d.x + d.w) / tile_size);
+		int y1 = SDL_min(rows - 1, (int)SDL_ceilf(d.y + d.h) / tile_size);
+		tile_ranges[i] = { x0, y0, x1, y1 };
+		for (int y = y0; y <= y1; y++) {
+			for (int x = x0; x <= x1; x++) {
+				tile_offsets[(size_t)y * columns + x + 1] += 1;
+			}
+		}
+	}
+	for (size_t t = 0; t < tile_count; t++) {
+		tile_offsets[t + 1] += tile_offsets[t];
+	}
+
+	binned.resize(tile_offsets[tile_count]);
+	for (size_t i = 0; i < blits.size(); i++) {
+		const SDL_Rect& r = tile_ranges[i];
+		for (int y = r.y; y <= r.h; y++) {
+			for (int x = r.x; x <= r.w; x++) {
+				binned[tile_offsets[(size_t)y * columns + x]++] = (unsigned int)i;
+			}
+		}
+	}
+	// Filling moved every offset to the start of the next tile, shift them back
+	for (size_t t = tile_count; t > 0; t--) {
+		tile_offsets[t] = tile_offsets[t - 1];
+	}
+	tile_offsets[0] = 0;
+}
+
+void blit_batch::flush(SDL_Surface* target, const SDL_Rect* clip, bool parallel)
+{
+	if (blits.empty() || target == nullptr) {
+		blits.clear();
+		return;
+	}
+	SDL_Rect area{ 0, 0, target->w, target->h };
+	if (clip != nullptr && !SDL_IntersectRect(clip, &area, &area)) {
+		blits.clear();
+		return;
+	}
+	int columns = (target->w + tile_size - 1) / tile_size;
+	int rows = (target->h + tile_size - 1) / tile_size;
+	if (!parallel || jobs::get_worker_count() == 0 || columns * rows < 2) {
+		for (const blit& b : blits) {
+			software_blit::draw(target, area, b.source, b.src, b.dst, b.colour, b.blend, b.filter);
+		}
+		blits.clear();
+		return;
+	}
+
+	bin(columns, rows);
+	// Tiles stay on the same grid whatever the clip, the ones outside it have nothing to do
+	jobs::parallel_for((size_t)columns * rows, TILES_PER_JOB, [&](size_t begin, size_t end) {
+		for (size_t t = begin; t < end; t++) {
+			SDL_Rect tile{ (int)(t % columns) * tile_size, (int)(t / columns) * tile_size, tile_size, tile_size };
+			SDL_Rect tile_clip;
+			if (!SDL_IntersectRect(&tile, &area, &tile_clip)) {
+				continue;
+			}
+			for (size_t i = tile_offsets[t]; i < tile_offsets[t + 1]; i++) {
+				const blit& b = blits[binned[i]];
+				software_blit::draw(target, tile_clip, b.source, b.src, b.dst, b.colour, b.blend, b.filter);
+			}
+		}
+	});
+	blits.clear();
+}
+
+bool blit_batch::is_empty() const
+{
+	return blits.empty();
+}
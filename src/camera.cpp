@@ -0,0 +1,28 @@
+#include "camera.h"
+
+SDL_FRect camera::get_view() const
+{
+	return { position.x, position.y, screen_size.x / zoom, screen_size.y / zoom };
+}
+
+bool camera::is_visible(const SDL_FRect& bounds) const
+{
+	SDL_FRect view = get_view();
+	return bounds.x <= view.x + view.w && bounds.x + bounds.w >= view.x
+		&& bounds.y <= view.y + view.h && bounds.y + bounds.h >= view.y;
+}
+
+SDL_FPoint camera::to_screen(const SDL_FPoint& point) const
+{
+	return { (point.x - position.x) * zoom, (point.y - position.y) * zoom };
+}
+
+SDL_FRect camera::to_screen(const SDL_FRect& rect) const
+{
+	return { (rect.x - position.x) * zoom, (rect.y - position.y) * zoom, rect.w * zoom, rect.h * zoom };
+}
+
+SDL_FPoint camera::to_world(const SDL_FPoint& point) const
+{
+	return { point.x / zoom + position.x, point.y / zoom + position.y };
+}
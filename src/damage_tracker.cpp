@@ -0,0 +1,149 @@
+#include "damage_tracker.h"
+
+#include <algorithm>
+#include <string.h>
+#include <SDL/SDL.h>
+#include "render_queue.h"
+
+// Past this much of the screen a single full redraw is cheaper than the separate areas
+#define FULL_REDRAW_COVERAGE 0.6f
+
+#define HASH_PRIME 1099511628211ull
+
+static unsigned long long mix(unsigned long long h, unsigned long long value)
+{
+	return (h ^ value) * HASH_PRIME;
+}
+
+static unsigned long long mix_float(unsigned long long h, float value)
+{
+	Uint32 bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return mix(h, bits);
+}
+
+// Field by field, the padding in the command is not initialised
+static unsigned long long hash_command(render_key key, const render_command& c)
+{
+	unsigned long long h = mix(14695981039346656037ull, key);
+	h = mix(h, (unsigned long long)c.type);
+	h = mix(h, (unsigned long long)(uintptr_t)c.texture);
+	h = mix(h, ((unsigned long long)(Uint32)c.src.x << 32) | (Uint32)c.src.y);
+	h = mix(h, ((unsigned long long)(Uint32)c.src.w << 32) | (Uint32)c.src.h);
+	h = mix_float(h, c.dst.x);
+	h = mix_float(h, c.dst.y);
+	h = mix_float(h, c.dst.w);
+	h = mix_float(h, c.dst.h);
+	return mix(h, ((Uint32)c.colour.r << 24) | ((Uint32)c.colour.g << 16) | ((Uint32)c.colour.b << 8) | c.colour.a);
+}
+
+// Whole pixels around everything the command can touch, outlines get a pixel extra for rounding
+static SDL_Rect get_bounds(const render_command& c)
+{
+	const SDL_FRect& d = c.dst;
+	SDL_FRect area;
+	switch (c.type) {
+	case RENDER_LINE:
+		area = { SDL_min(d.x, d.w), SDL_min(d.y, d.h), SDL_fabsf(d.w - d.x), SDL_fabsf(d.h - d.y) };
+		break;
+	case RENDER_CIRCLE:
+	case RENDER_FILL_CIRCLE:
+		area = { d.x - d.w, d.y - d.w, d.w * 2.0f, d.w * 2.0f };
+		break;
+	case RENDER_CAPSULE:
+		area = { d.x - d.w * 0.5f - d.h, d.y - d.h, d.w + d.h * 2.0f, d.h * 2.0f };
+		break;
+	default:
+		area = d;
+		break;
+	}
+	int x0 = (int)SDL_floorf(area.x) - 1;
+	int y0 = (int)SDL_floorf(area.y) - 1;
+	int x1 = (int)SDL_ceilf(area.x + area.w) + 1;
+	int y1 = (int)SDL_ceilf(area.y + area.h) + 1;
+	return { x0, y0, x1 - x0, y1 - y0 };
+}
+
+void damage_tracker::create(int screen_width, int screen_height)
+{
+	screen = { 0, 0, screen_width, screen_height };
+	previous.clear();
+	invalidate();
+}
+
+void damage_tracker::invalidate()
+{
+	invalidated = true;
+}
+
+// Anything touching an existing area is merged into it, until the list is disjoint again
+void damage_tracker::add_damage(const SDL_Rect& rect, std::vector<SDL_Rect>& rects) const
+{
+	SDL_Rect merged;
+	if (!SDL_IntersectRect(&rect, &screen, &merged)) {
+		return;
+	}
+	for (size_t i = 0; i < rects.size(); i++) {
+		if (SDL_HasIntersection(&rects[i], &merged)) {
+			SDL_UnionRect(&rects[i], &merged, &merged);
+			rects[i] = rects.back();
+			rects.pop_back();
+			i = (size_t)-1;
+		}
+	}
+	rects.push_back(merged);
+}
+
+bool damage_tracker::update(const render_queue& queue, std::vector<SDL_Rect>& out_rects)
+{
+	out_rects.clear();
+	current.resize(queue.size());
+	for (size_t i = 0; i < queue.size(); i++) {
+		const render_command& c = queue.get_command(i);
+		current[i] = { hash_command(queue.get_key(i), c), get_bounds(c) };
+	}
+	auto by_hash = [](const entry& lhs, const entry& rhs) { return lhs.hash < rhs.hash; };
+	std::sort(current.begin(), current.end(), by_hash);
+
+	if (invalidated) {
+		out_rects.push_back(screen);
+	}
+	else {
+		// Both lists are sorted, whatever only one of them has is damage
+		size_t a = 0;
+		size_t b = 0;
+		while (a < previous.size() || b < current.size()) {
+			if (b == current.size() || (a < previous.size() && previous[a].hash < current[b].hash)) {
+				add_damage(previous[a++].bounds, out_rects);
+			}
+			else if (a == previous.size() || current[b].hash < previous[a].hash) {
+				add_damage(current[b++].bounds, out_rects);
+			}
+			else {
+				a++;
+				b++;
+			}
+		}
+	}
+	previous.swap(current);
+	invalidated = false;
+	if (out_rects.empty()) {
+		return false;
+	}
+
+	if (out_rects.size() > max_rects) {
+		for (size_t i = 1; i < out_rects.size(); i++) {
+			SDL_UnionRect(&out_rects[0], &out_rects[i], &out_rects[0]);
+		}
+		out_rects.resize(1);
+	}
+	int area = 0;
+	for (const SDL_Rect& r : out_rects) {
+		area += r.w * r.h;
+	}
+	if (area > screen.w * screen.h * FULL_REDRAW_COVERAGE) {
+		out_rects.clear();
+		out_rects.push_back(screen);
+	}
+	return true;
+}
@@ -0,0 +1,113 @@
+#include "debug_draw.h"
+
+#ifdef DVD_DEBUG_DRAW
+#include <vector>
+#include <SDL/SDL.h>
+#include "shape_batch.h"
+
+enum debug_shape
+{
+	DEBUG_SHAPE_RECT,
+	DEBUG_SHAPE_LINE,
+	DEBUG_SHAPE_CIRCLE,
+	DEBUG_SHAPE_CAPSULE
+};
+
+struct debug_command
+{
+	debug_shape shape;
+	SDL_Colour colour;
+	// rect: x y w h, line: a b, circle: x y radius, capsule: position size
+	float data[4];
+};
+
+// One buffer records while the other one is flushed, possibly on the render thread
+static std::vector<debug_command> buffers[2];
+static int recording{ 0 };
+// Colours go into the vertices, so every shape of every colour is one SDL_RenderGeometry call
+static shape_batch outlines;
+
+// Shapes are recorded already culled and in screen space, the camera might move before they are flushed
+void debug_draw::rect(const SDL_FRect& rect, SDL_Colour colour)
+{
+	const camera& view = engine::get_camera();
+	if (view.is_visible(rect)) {
+		SDL_FRect r = view.to_screen(rect);
+		buffers[recording].push_back({ DEBUG_SHAPE_RECT, colour, { r.x, r.y, r.w, r.h } });
+	}
+}
+
+void debug_draw::line(const SDL_FPoint& a, const SDL_FPoint& b, SDL_Colour colour)
+{
+	const camera& view = engine::get_camera();
+	SDL_FRect bounds{ SDL_min(a.x, b.x), SDL_min(a.y, b.y), SDL_fabsf(b.x - a.x), SDL_fabsf(b.y - a.y) };
+	if (view.is_visible(bounds)) {
+		SDL_FPoint screen_a = view.to_screen(a);
+		SDL_FPoint screen_b = view.to_screen(b);
+		buffers[recording].push_back({ DEBUG_SHAPE_LINE, colour, { screen_a.x, screen_a.y, screen_b.x, screen_b.y } });
+	}
+}
+
+void debug_draw::circle(const SDL_FCircle& circle, SDL_Colour colour)
+{
+	const camera& view = engine::get_camera();
+	SDL_FRect bounds{ circle.x - circle.radius, circle.y - circle.radius, circle.radius * 2.0f, circle.radius * 2.0f };
+	if (view.is_visible(bounds)) {
+		SDL_FPoint center = view.to_screen(SDL_FPoint{ circle.x, circle.y });
+		buffers[recording].push_back({ DEBUG_SHAPE_CIRCLE, colour, { center.x, center.y, circle.radius * view.zoom, 0.0f } });
+	}
+}
+
+void debug_draw::capsule(const SDL_FHorizontalCapsule& capsule, SDL_Colour colour)
+{
+	const camera& view = engine::get_camera();
+	SDL_FRect bounds{ capsule.position.x - capsule.size.x * 0.5f - capsule.size.y, capsule.position.y - capsule.size.y, capsule.size.x + capsule.size.y * 2.0f, capsule.size.y * 2.0f };
+	if (view.is_visible(bounds)) {
+		SDL_FPoint center = view.to_screen(capsule.position);
+		buffers[recording].push_back({ DEBUG_SHAPE_CAPSULE, colour, { center.x, center.y, capsule.size.x * view.zoom, capsule.size.y * view.zoom } });
+	}
+}
+
+void debug_draw::swap()
+{
+	recording ^= 1;
+	buffers[recording].clear();
+}
+
+void debug_draw::flush(SDL_Renderer* renderer)
+{
+	std::vector<debug_command>& commands = buffers[recording ^ 1];
+	if (commands.empty()) {
+		return;
+	}
+	for (const debug_command& c : commands) {
+		switch (c.shape) {
+		case DEBUG_SHAPE_RECT:
+			outlines.add_rect({ c.data[0], c.data[1], c.data[2], c.data[3] }, c.colour);
+			break;
+		case DEBUG_SHAPE_LINE:
+			outlines.add_line({ c.data[0], c.data[1] }, { c.data[2], c.data[3] }, c.colour);
+			break;
+		case DEBUG_SHAPE_CIRCLE:
+			outlines.add_circle({ c.data[0], c.data[1] }, c.data[2], c.colour);
+			break;
+		case DEBUG_SHAPE_CAPSULE:
+			// Same as engine::draw_capsule, equal sizes are drawn as a circle
+			if (SDL_fabsf(c.data[2] - c.data[3]) < 0.00001f) {
+				outlines.add_circle({ c.data[0], c.data[1] }, c.data[2], c.colour);
+			}
+			else {
+				outlines.add_capsule({ c.data[0], c.data[1] }, { c.data[2], c.data[3] }, c.colour);
+			}
+			break;
+		}
+	}
+	outlines.flush(renderer);
+	commands.clear();
+}
+
+size_t debug_draw::count()
+{
+	return buffers[recording].size();
+}
+#endif
@@ -1,9 +1,44 @@
 
 #include "engine.h"
+#include "arena.h"
+#include "asset_loader.h"
+#include "asset_pack.h"
+#include "atlas.h"
+#include "camera.h"
+#include "damage_tracker.h"
+#include "debug_draw.h"
+#include "file_watcher.h"
+#include "glyph_cache.h"
+#include "sdf_font.h"
+#include "tilemap.h"
+#include "jobs.h"
+#include "render_queue.h"
+#include "render_thread.h"
+#include "software_blit.h"
+#include "startup_timer.h"
 #include <SDL/SDL.h>
 #include <SDL/SDL_ttf.h>
 #include <SDL/SDL_image.h>
 #include <stdio.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+struct texture_asset
+{
+	SDL_Texture* texture;
+	int width, height;
+};
+
+struct font_asset
+{
+	sdf_font font;
+	glyph_cache glyphs;
+};
+
+// Unused textures kept around before the oldest get unloaded
+#define DEFAULT_TEXTURE_BUDGET (64 * 1024 * 1024)
 void SDL_FPointNormalise(SDL_FPoint* v)
 {
 	float length = sqrtf(v->x * v->x + v->y * v->y);
@@ -19,30 +54,6 @@ SDL_FPoint SDL_FPointGetNormalised(SDL_FPoint v)
 	return v;
 }
 
-void SDL_RenderDrawCircleF(SDL_Renderer* renderer, const SDL_FCircle* circle)
-{
-	int resolution = 48;
-	float step = (2 * 3.14f) / resolution;
-
-	for (int i = 0; i < resolution; ++i)
-	{
-		float angle = step * i;
-		float x1 = cosf(angle);
-		float y1 = sinf(angle);
-
-		float next_angle = step * (i + 1);
-		float x2 = cosf(next_angle);
-		float y2 = sinf(next_angle);
-
-		SDL_RenderDrawLineF(renderer,
-			x1 * circle->radius + circle->x,
-			y1 * circle->radius + circle->y,
-			x2 * circle->radius + circle->x,
-			y2 * circle->radius + circle->y
-		);
-	}
-}
-
 float SDL_FPointDot(SDL_FPoint lhs, SDL_FPoint rhs)
 {
 	return lhs.x * rhs.x + lhs.y * rhs.y;
@@ -173,50 +184,507 @@ namespace engine
 {
 	static SDL_Window* window{ nullptr };
 	static SDL_Renderer* renderer{ nullptr };
+	static render_backend backend{ RENDER_BACKEND_HARDWARE };
+	// Software backend only, frames are drawn into the framebuffer and copied to the window surface when presented
+	static SDL_Surface* framebuffer{ nullptr };
+	static SDL_Surface* window_surface{ nullptr };
+
+	// Capture requests are taken by the next render_present, the hash is written by the render thread
+	static std::string capture_path;
+	static capture_format capture_as{ CAPTURE_PNG };
+	static bool hashing{ false };
+	static Uint64 frame_hash{ 0 };
 
-	static SDL_Texture* entity_texture{ nullptr };
-	static SDL_Texture* tiles_texture{ nullptr };
-	static TTF_Font* font{ nullptr };
+	// Dirty rendering, the damage is found on the main thread before the frame is handed over
+	// The hardware backend keeps the frame in the canvas, its back buffer is gone after every present
+	static bool dirty_rendering{ false };
+	static damage_tracker damage;
+	static SDL_Texture* canvas{ nullptr };
+	static bool debug_drawn{ false };
+
+	// Every sprite sheet lives in the atlas, so entities and tiles can share a batch
+	static texture_atlas atlas;
+	static atlas_handle entity_sheet{ INVALID_ATLAS_HANDLE };
+	static atlas_handle tiles_sheet{ INVALID_ATLAS_HANDLE };
+	static std::unordered_map<std::string, atlas_handle> sheets;
 
 	static SDL_Point entity_size;
 	static SDL_Point tile_size;
 
-	bool load_texture(const char* path, SDL_Texture*& out_texture)
+	// Textures outside the atlas and fonts, shared by path and counted
+	static asset_registry<texture_asset> textures;
+	static asset_registry<font_asset> fonts;
+	static font_handle text_font;
+	// Assets found in here skip decoding and the loader threads, whatever is missing still comes from the loose files
+	static asset_pack pack;
+
+	// Textures the frame being recorded might still draw, they are handed over with it and freed once it is done
+	static std::vector<SDL_Texture*> retired_textures;
+	static std::vector<SDL_Texture*> retired_in_flight;
+	// Changed files decoded again, swapped in at the next frame boundary
+	static bool hot_reload{ false };
+	static std::vector<std::pair<std::string, SDL_Surface*>> reloaded;
+	// Chunks baked from an older tiles sheet are baked again
+	static unsigned int tiles_sheet_version{ 0 };
+
+	// SDL_image and SDL_ttf start with the first file that needs them, TTF is not thread safe so bakes take turns
+	static std::mutex image_mutex;
+	static std::mutex ttf_mutex;
+	// Startup ends with the first frame after everything loading at the time is in
+	static unsigned long long initialised_at{ 0 };
+	static bool first_frame_submitted{ false };
+
+	// Everything drawn in a frame is queued and sorted at present, layer and depth go into the key of every command
+	// One queue records on the main thread while the render thread submits the other one
+	static render_queue queues[2];
+	static int recording{ 0 };
+	static bool clear_requested{ false };
+	static int draw_layer{ DEFAULT_DRAW_LAYER };
+	static int draw_depth{ 0 };
+
+	// Draw calls take world coordinates, anything outside the view is dropped before it reaches the queue
+	static camera view;
+
+	// Tilemap chunks to bake before the frame is drawn, recorded per frame like the queues
+	struct tile_copy
+	{
+		SDL_Texture* source;
+		SDL_Rect src;
+		SDL_Rect dst;
+	};
+
+	struct chunk_bake
+	{
+		SDL_Texture* target;
+		size_t first_copy;
+		size_t copy_count;
+	};
+
+	static std::vector<chunk_bake> bakes[2];
+	static std::vector<tile_copy> bake_copies[2];
+
+	// Runs on the render thread, tiles are copied as they are, blending them into the empty target would darken the edges
+	static void bake_chunks(int frame)
+	{
+		if (bakes[frame].empty()) {
+			return;
+		}
+		SDL_Colour previous;
+		SDL_GetRenderDrawColor(renderer, &previous.r, &previous.g, &previous.b, &previous.a);
+		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+		for (const auto& bake : bakes[frame]) {
+			SDL_SetRenderTarget(renderer, bake.target);
+			SDL_RenderClear(renderer);
+			for (size_t i = bake.first_copy; i < bake.first_copy + bake.copy_count; i++) {
+				const tile_copy& copy = bake_copies[frame][i];
+				SDL_SetTextureBlendMode(copy.source, SDL_BLENDMODE_NONE);
+				SDL_RenderCopy(renderer, copy.source, &copy.src, &copy.dst);
+				SDL_SetTextureBlendMode(copy.source, SDL_BLENDMODE_BLEND);
+			}
+		}
+		SDL_SetRenderTarget(renderer, nullptr);
+		SDL_SetRenderDrawColor(renderer, previous.r, previous.g, previous.b, previous.a);
+		bakes[frame].clear();
+		bake_copies[frame].clear();
+	}
+
+	// Runs on the render thread, the software backends hand out their framebuffer, the hardware one a copy the caller frees
+	static SDL_Surface* read_frame()
+	{
+		if (framebuffer != nullptr) {
+			SDL_RenderFlush(renderer);
+			return framebuffer;
+		}
+		int width;
+		int height;
+		SDL_GetRendererOutputSize(renderer, &width, &height);
+		SDL_Surface* frame = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_RGBA32);
+		if (frame != nullptr && SDL_RenderReadPixels(renderer, nullptr, SDL_PIXELFORMAT_RGBA32, frame->pixels, frame->pitch) != 0) {
+			printf("Could not read the frame back: %s\n", SDL_GetError());
+			SDL_FreeSurface(frame);
+			frame = nullptr;
+		}
+		return frame;
+	}
+
+	// Loader thread, RGBA32 whatever the file is so the blitter and the atlas take it as is
+	static SDL_Surface* decode_image(const std::string& path)
+	{
+		{
+			std::lock_guard<std::mutex> lock(image_mutex);
+			if ((IMG_Init(0) & IMG_INIT_PNG) == 0) {
+				unsigned long long start = startup_timer::now();
+				IMG_Init(IMG_INIT_PNG);
+				startup_timer::record("img", start);
+			}
+		}
+		unsigned long long start = startup_timer::now();
+		SDL_Surface* loaded = IMG_Load(path.c_str());
+		if (loaded == nullptr) {
+			printf("Could not load %s: %s\n", path.c_str(), IMG_GetError());
+			return nullptr;
+		}
+		SDL_Surface* converted = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+		SDL_FreeSurface(loaded);
+		startup_timer::record("image decode", start);
+		return converted;
+	}
+
+	// The pixels straight out of the mapped pack, nullptr when the pack does not have them
+	static SDL_Surface* find_packed_image(const char* path)
 	{
-		out_texture = IMG_LoadTexture(renderer, path);
-		return out_texture != nullptr;
+		const asset_pack_entry* entry = pack.find(path);
+		if (entry == nullptr) {
+			return nullptr;
+		}
+		unsigned long long start = startup_timer::now();
+		SDL_Surface* surface = pack.create_surface(*entry);
+		startup_timer::record("pack image", start);
+		return surface;
 	}
 
-	void load_font(const char* path)
+	// Takes the pixels over, the software backend keeps them for the blitter
+	static SDL_Texture* create_texture(SDL_Surface* pixels)
 	{
-		font = TTF_OpenFont(path, 72);
-		if (font == nullptr) {
-			// Error
+		SDL_Texture* texture = nullptr;
+		render_thread::call([&]() {
+			texture = SDL_CreateTextureFromSurface(renderer, pixels);
+		});
+		if (texture == nullptr || backend == RENDER_BACKEND_HARDWARE) {
+			SDL_FreeSurface(pixels);
+			return texture;
 		}
+		software_blit::add_pixels(texture, pixels);
+		return texture;
 	}
 
-	void free_texture(SDL_Texture*& texture)
+	static void free_texture(SDL_Texture*& texture)
 	{
 		if (texture != nullptr) {
-			SDL_DestroyTexture(texture);
+			// The frame in flight might still draw it
+			render_thread::wait_idle();
+			SDL_Surface* pixels = software_blit::find_pixels(texture);
+			software_blit::remove_pixels(texture);
+			SDL_FreeSurface(pixels);
+			render_thread::call([&]() {
+				SDL_DestroyTexture(texture);
+			});
 			texture = nullptr;
 		}
 	}
 
-	void initialise(int width, int height)
+	// Once the frame in flight is done
+	static void free_retired_textures()
 	{
-		SDL_Init(SDL_INIT_EVERYTHING);
-		SDL_CreateWindowAndRenderer(width, height, 0, &window, &renderer);
-		IMG_Init(IMG_INIT_JPG);
-		TTF_Init();
+		for (SDL_Texture* t : retired_in_flight) {
+			free_texture(t);
+		}
+		retired_in_flight.clear();
 	}
 
-	void load_entities_texture(const char* path)
+	texture_handle load_texture(const char* path)
 	{
-		free_texture(entity_texture);
-		if (load_texture(path, entity_texture)) {
-			// Error here
+		texture_handle handle = textures.acquire(path);
+		if (handle.is_valid()) {
+			return handle;
 		}
+		handle = textures.add(path, { nullptr, 0, 0 });
+		file_watcher::watch(path);
+		if (SDL_Surface* packed = find_packed_image(path)) {
+			// Created from the mapped pixels, the software backend even draws from them directly
+			texture_asset* t = textures.get(handle);
+			t->width = packed->w;
+			t->height = packed->h;
+			t->texture = create_texture(packed);
+			textures.set_bytes(handle, t->texture != nullptr ? (size_t)t->width * t->height * 4 : 0);
+			return handle;
+		}
+		std::string file = path;
+		auto decoded = std::make_shared<SDL_Surface*>(nullptr);
+		asset_loader::load([file, decoded]() {
+			*decoded = decode_image(file);
+		},
+		[handle, decoded]() {
+			texture_asset* t = textures.get(handle);
+			if (t == nullptr || *decoded == nullptr) {
+				// Released and unloaded before it was even in
+				SDL_FreeSurface(*decoded);
+				return;
+			}
+			t->width = (*decoded)->w;
+			t->height = (*decoded)->h;
+			t->texture = create_texture(*decoded);
+			if (t->texture != nullptr) {
+				textures.set_bytes(handle, (size_t)t->width * t->height * 4);
+			}
+		});
+		return handle;
+	}
+
+	void release_texture(texture_handle texture)
+	{
+		textures.release(texture);
+	}
+
+	bool is_loaded(texture_handle texture)
+	{
+		texture_asset* t = textures.get(texture);
+		return t != nullptr && t->texture != nullptr;
+	}
+
+	void set_texture_budget(size_t bytes)
+	{
+		textures.set_budget(bytes);
+	}
+
+	size_t get_texture_memory()
+	{
+		return textures.get_used_bytes();
+	}
+
+	static bool load_packed_font(const char* path, font_handle handle)
+	{
+		const asset_pack_entry* packed = pack.find(path);
+		font_asset* f = fonts.get(handle);
+		unsigned long long start = startup_timer::now();
+		if (packed == nullptr || packed->type != ASSET_PACK_FONT || !f->font.read_cache(pack.get_data(*packed), (size_t)packed->size)) {
+			return false;
+		}
+		startup_timer::record("pack font", start);
+		f->glyphs.create(&f->font, &atlas);
+		fonts.set_bytes(handle, f->font.get_memory());
+		return true;
+	}
+
+	static void load_font_async(const char* path, const char* cache_path, font_handle handle)
+	{
+		// Baked on a loader thread into a font of its own, text draws nothing until it is moved in
+		std::string ttf_path = path;
+		std::string cache = cache_path != nullptr ? cache_path : "";
+		auto loaded = std::make_shared<sdf_font>();
+		asset_loader::load([ttf_path, cache, loaded]() {
+			// A valid cache skips opening the TTF entirely
+			unsigned long long start = startup_timer::now();
+			if (!cache.empty() && loaded->load_cache(cache.c_str(), ttf_path.c_str())) {
+				startup_timer::record("font cache", start);
+				return;
+			}
+			std::lock_guard<std::mutex> lock(ttf_mutex);
+			if (!TTF_WasInit()) {
+				start = startup_timer::now();
+				TTF_Init();
+				startup_timer::record("ttf", start);
+			}
+			start = startup_timer::now();
+			if (loaded->bake(ttf_path.c_str()) && !cache.empty() && !loaded->save_cache(cache.c_str(), ttf_path.c_str())) {
+				printf("Could not write font cache %s\n", cache.c_str());
+			}
+			startup_timer::record("font bake", start);
+		},
+		[handle, loaded]() {
+			font_asset* f = fonts.get(handle);
+			if (f == nullptr || !loaded->is_baked()) {
+				return;
+			}
+			f->font = std::move(*loaded);
+			f->glyphs.create(&f->font, &atlas);
+			fonts.set_bytes(handle, f->font.get_memory());
+		});
+	}
+
+	font_handle load_font(const char* path, const char* cache_path)
+	{
+		font_handle handle = fonts.acquire(path);
+		if (!handle.is_valid()) {
+			handle = fonts.add(path, {});
+			if (!load_packed_font(path, handle)) {
+				load_font_async(path, cache_path, handle);
+			}
+		}
+		if (fonts.get(text_font) == nullptr) {
+			text_font = handle;
+		}
+		return handle;
+	}
+
+	void release_font(font_handle font)
+	{
+		fonts.release(font);
+	}
+
+	void set_font(font_handle font)
+	{
+		text_font = font;
+	}
+
+	void initialise(int width, int height, int worker_threads, bool threaded_rendering, render_backend selected_backend)
+	{
+		startup_timer::begin();
+		backend = selected_backend;
+		if (backend == RENDER_BACKEND_HEADLESS) {
+			// Nothing that needs a display, a video driver picked in the environment still wins
+			SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+		}
+		// Video brings events along, audio, controllers and the rest wait for require_subsystems
+		unsigned long long start = startup_timer::now();
+		SDL_Init(SDL_INIT_VIDEO);
+		startup_timer::record("sdl", start);
+		if (backend != RENDER_BACKEND_HEADLESS) {
+			// The window stays with the main thread, the renderer is created on the render thread
+			start = startup_timer::now();
+			window = SDL_CreateWindow("", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, width, height, 0);
+			startup_timer::record("window", start);
+		}
+		start = startup_timer::now();
+		if (backend != RENDER_BACKEND_HARDWARE) {
+			window_surface = window != nullptr ? SDL_GetWindowSurface(window) : nullptr;
+			framebuffer = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_RGBA32);
+			SDL_SetSurfaceBlendMode(framebuffer, SDL_BLENDMODE_NONE);
+			renderer = render_thread::start(framebuffer, threaded_rendering);
+		}
+		else {
+			renderer = render_thread::start(window, 0, threaded_rendering);
+		}
+		startup_timer::record("renderer", start);
+		view.screen_size = { (float)width, (float)height };
+		damage.create(width, height);
+		start = startup_timer::now();
+		atlas.create(renderer, 1024);
+		arena::initialise(1024 * 1024, 4 * 1024 * 1024);
+		jobs::initialise(worker_threads);
+		asset_loader::initialise();
+		startup_timer::record("engine", start);
+		first_frame_submitted = false;
+		textures.create(DEFAULT_TEXTURE_BUDGET, [](texture_asset& t) {
+			retired_textures.push_back(t.texture);
+		});
+		// Fonts are only kept while referenced, their glyphs are in the atlas already
+		fonts.create(0, [](font_asset& f) {
+			f.glyphs.destroy();
+		});
+		initialised_at = startup_timer::now();
+	}
+
+	bool require_subsystems(Uint32 sdl_flags)
+	{
+		Uint32 missing = sdl_flags & ~SDL_WasInit(sdl_flags);
+		if (missing == 0) {
+			return true;
+		}
+		unsigned long long start = startup_timer::now();
+		bool started = SDL_InitSubSystem(missing) == 0;
+		startup_timer::record("sdl subsystems", start);
+		if (!started) {
+			printf("Could not start SDL subsystems %x: %s\n", missing, SDL_GetError());
+		}
+		return started;
+	}
+
+	void shutdown()
+	{
+		set_dirty_rendering(false);
+		// Whatever is still loading finishes into the atlas before it goes away
+		asset_loader::shutdown();
+		render_thread::wait_idle();
+		jobs::shutdown();
+		arena::shutdown();
+		set_hot_reload(false);
+		textures.destroy();
+		retired_in_flight.insert(retired_in_flight.end(), retired_textures.begin(), retired_textures.end());
+		retired_textures.clear();
+		free_retired_textures();
+		fonts.destroy();
+		sheets.clear();
+		// Software textures from the pack draw from the mapping, they are gone by now
+		pack.close();
+		atlas.destroy();
+		queues[0].clear();
+		queues[1].clear();
+		render_thread::stop();
+		SDL_FreeSurface(framebuffer);
+		if (window != nullptr) {
+			SDL_DestroyWindow(window);
+		}
+		renderer = nullptr;
+		framebuffer = nullptr;
+		window_surface = nullptr;
+		window = nullptr;
+		if (TTF_WasInit()) {
+			TTF_Quit();
+		}
+		IMG_Quit();
+		SDL_Quit();
+	}
+
+	atlas_handle load_sprite_sheet(const char* path)
+	{
+		auto found = sheets.find(path);
+		if (found != sheets.end()) {
+			return found->second;
+		}
+		// Uploaded with the next frame
+		atlas_handle handle = INVALID_ATLAS_HANDLE;
+		if (SDL_Surface* packed = find_packed_image(path)) {
+			handle = atlas.add(packed);
+			SDL_FreeSurface(packed);
+		}
+		else {
+			handle = atlas.add(path);
+		}
+		if (handle != INVALID_ATLAS_HANDLE) {
+			sheets[path] = handle;
+			file_watcher::watch(path);
+		}
+		return handle;
+	}
+
+	atlas_handle load_sprite_sheet_async(const char* path)
+	{
+		auto found = sheets.find(path);
+		if (found != sheets.end()) {
+			return found->second;
+		}
+		atlas_handle handle = atlas.reserve();
+		sheets[path] = handle;
+		file_watcher::watch(path);
+		if (SDL_Surface* packed = find_packed_image(path)) {
+			// Nothing to decode, packing it right away is just a copy
+			atlas.fill(handle, packed);
+			SDL_FreeSurface(packed);
+			return handle;
+		}
+		std::string file = path;
+		auto decoded = std::make_shared<SDL_Surface*>(nullptr);
+		asset_loader::load([file, decoded]() {
+			// Converted here as well, packing on the main thread is then just a copy
+			*decoded = decode_image(file);
+		},
+		[handle, decoded]() {
+			// Packed into the atlas here, uploaded by the render thread with the next frame
+			atlas.fill(handle, *decoded);
+			SDL_FreeSurface(*decoded);
+		});
+		return handle;
+	}
+
+	bool open_asset_pack(const char* path)
+	{
+		return pack.open(path);
+	}
+
+	void wait_for_loads()
+	{
+		asset_loader::wait_all();
+	}
+
+	int get_loads_pending()
+	{
+		return asset_loader::get_pending_count();
+	}
+
+	void load_entities_texture(const char* path)
+	{
+		entity_sheet = load_sprite_sheet_async(path);
 	}
 
 	void set_entity_source_size(int width, int height)
@@ -231,116 +699,503 @@ namespace engine
 
 	void load_tiles_texture(const char* path)
 	{
-		free_texture(tiles_texture);
-		if (load_texture(path, tiles_texture)) {
-			// Error here
+		tiles_sheet = load_sprite_sheet_async(path);
+	}
+
+	void set_draw_layer(int layer)
+	{
+		draw_layer = layer;
+	}
+
+	void set_draw_depth(int depth)
+	{
+		draw_depth = depth;
+	}
+
+	void set_camera(const SDL_FPoint& position, float zoom)
+	{
+		view.position = position;
+		view.zoom = zoom > 0.0f ? zoom : 1.0f;
+	}
+
+	const camera& get_camera()
+	{
+		return view;
+	}
+
+	void draw_texture(texture_handle texture, const SDL_Rect& src, const SDL_FRect& dst)
+	{
+		texture_asset* t = textures.get(texture);
+		if (t == nullptr || t->texture == nullptr || !view.is_visible(dst)) {
+			return;
 		}
+		queues[recording].push_sprite(draw_layer, draw_depth, t->texture, src, view.to_screen(dst));
 	}
 
-	void draw(SDL_Texture*& texture, const SDL_Rect& src, const SDL_FRect& dst)
+	void draw_sprite(atlas_handle sheet, const SDL_Rect& src, const SDL_FRect& dst)
 	{
-		SDL_RenderCopyF(renderer, texture, &src, &dst);
+		const atlas_region* region = atlas.get(sheet);
+		// Sheets still loading draw nothing
+		if (region == nullptr || region->texture == nullptr || !view.is_visible(dst)) {
+			return;
+		}
+		SDL_Rect atlas_src{ region->rect.x + src.x, region->rect.y + src.y, src.w, src.h };
+		queues[recording].push_sprite(draw_layer, draw_depth, region->texture, atlas_src, view.to_screen(dst));
 	}
 
 	void draw_tile(const SDL_Point& tile, const SDL_FRect& dst)
 	{
 		SDL_Rect src{ tile.x * tile_size.x, tile.y * tile_size.y, tile_size.x, tile_size.y };
-		SDL_RenderCopyF(renderer, tiles_texture, &src, &dst);
+		draw_sprite(tiles_sheet, src, dst);
 	}
 
 	void draw_rect(const SDL_FRect& rect, SDL_Colour colour)
 	{
-		SDL_Colour p_c;
-		SDL_GetRenderDrawColor(renderer, &p_c.r, &p_c.g, &p_c.b, &p_c.a);
-
-		SDL_Colour c = colour;
-		SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, c.a);
-		SDL_RenderDrawRectF(renderer, &rect);
-		SDL_SetRenderDrawColor(renderer, p_c.r, p_c.g, p_c.b, p_c.a);
+		if (view.is_visible(rect)) {
+			queues[recording].push_shape(draw_layer, draw_depth, RENDER_RECT, view.to_screen(rect), colour);
+		}
+	}
+	void fill_rect(const SDL_FRect& rect, SDL_Colour colour)
+	{
+		if (view.is_visible(rect)) {
+			queues[recording].push_shape(draw_layer, draw_depth, RENDER_FILL_RECT, view.to_screen(rect), colour);
+		}
 	}
 	void draw_line(const SDL_FPoint a, const SDL_FPoint b, SDL_Colour colour)
 	{
-		SDL_Colour p_c;
-		SDL_GetRenderDrawColor(renderer, &p_c.r, &p_c.g, &p_c.b, &p_c.a);
-		SDL_Colour c = colour;
-		SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, c.a);
-
-		SDL_RenderDrawLineF(renderer, a.x, a.y, b.x, b.y);
-
-		SDL_SetRenderDrawColor(renderer, p_c.r, p_c.g, p_c.b, p_c.a);
-
+		SDL_FRect bounds{ SDL_min(a.x, b.x), SDL_min(a.y, b.y), SDL_fabsf(b.x - a.x), SDL_fabsf(b.y - a.y) };
+		if (view.is_visible(bounds)) {
+			SDL_FPoint screen_a = view.to_screen(a);
+			SDL_FPoint screen_b = view.to_screen(b);
+			queues[recording].push_shape(draw_layer, draw_depth, RENDER_LINE, { screen_a.x, screen_a.y, screen_b.x, screen_b.y }, colour);
+		}
 	}
 	void draw_circle(const SDL_FCircle& circle, SDL_Colour colour) 
 	{
-		SDL_Colour p_c;
-		SDL_GetRenderDrawColor(renderer, &p_c.r, &p_c.g, &p_c.b, &p_c.a);
-
-		SDL_Colour c = colour;
-		SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, c.a);
-
-		SDL_RenderDrawCircleF(renderer, &circle);
-
-		SDL_SetRenderDrawColor(renderer, p_c.r, p_c.g, p_c.b, p_c.a);
+		SDL_FRect bounds{ circle.x - circle.radius, circle.y - circle.radius, circle.radius * 2.0f, circle.radius * 2.0f };
+		if (view.is_visible(bounds)) {
+			SDL_FPoint center = view.to_screen(SDL_FPoint{ circle.x, circle.y });
+			queues[recording].push_shape(draw_layer, draw_depth, RENDER_CIRCLE, { center.x, center.y, circle.radius * view.zoom, 0.0f }, colour);
+		}
+	}
+	void fill_circle(const SDL_FCircle& circle, SDL_Colour colour)
+	{
+		SDL_FRect bounds{ circle.x - circle.radius, circle.y - circle.radius, circle.radius * 2.0f, circle.radius * 2.0f };
+		if (view.is_visible(bounds)) {
+			SDL_FPoint center = view.to_screen(SDL_FPoint{ circle.x, circle.y });
+			queues[recording].push_shape(draw_layer, draw_depth, RENDER_FILL_CIRCLE, { center.x, center.y, circle.radius * view.zoom, 0.0f }, colour);
+		}
 	}
 	void draw_text(const char* text, const SDL_FRect& dst)
 	{
-		SDL_Surface* surface = TTF_RenderText_Blended(font, text, { 255, 255, 255, 255 });
-		SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-		uint32_t format;
-		int access;
-		int width;
-		int height;
-		SDL_QueryTexture(texture, &format, &access, &width, &height);
-		draw(texture, { 0, 0, width, height }, dst);
-		SDL_DestroyTexture(texture);
-		SDL_FreeSurface(surface);
+		if (view.is_visible(dst)) {
+			if (font_asset* f = fonts.get(text_font)) {
+				f->glyphs.draw(text, view.to_screen(dst), { 255, 255, 255, 255 }, queues[recording], draw_layer, draw_depth);
+			}
+		}
+	}
+
+	void draw_text(const char* text, const SDL_FPoint& position, float pixel_height, SDL_Colour colour)
+	{
+		// The width is only known after laying it out, the quads get culled by the renderer instead
+		if (font_asset* f = fonts.get(text_font)) {
+			f->glyphs.draw(text, view.to_screen(position), pixel_height * view.zoom, colour, queues[recording], draw_layer, draw_depth);
+		}
 	}
 	void draw_capsule(const SDL_FHorizontalCapsule& capsule, SDL_Colour colour)
 	{
-		SDL_Colour p_c;
-		SDL_GetRenderDrawColor(renderer, &p_c.r, &p_c.g, &p_c.b, &p_c.a);
-		SDL_Colour c = colour;
-		SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, c.a);
-
 		// If size is the same on each side, just draw a circle
 		if (capsule.size.x > capsule.size.y - 0.00001f
 			&& capsule.size.x < capsule.size.y + 0.00001f) {
-			SDL_FCircle circle = { capsule.position.x, capsule.position.y, capsule.size.x };
-			SDL_RenderDrawCircleF(renderer, &circle);
+			draw_circle({ capsule.position.x, capsule.position.y, capsule.size.x }, colour);
+			return;
 		}
-		else {
-			SDL_FCircle a;
-			SDL_FCircle b;
-			a.x = capsule.position.x - capsule.size.x * 0.5f;
-			a.y = capsule.position.y;
-			a.radius = capsule.size.y;
-			b.x = capsule.position.x + capsule.size.x * 0.5f;
-			b.y = capsule.position.y;
-			b.radius = capsule.size.y;
+		SDL_FRect bounds{ capsule.position.x - capsule.size.x * 0.5f - capsule.size.y, capsule.position.y - capsule.size.y, capsule.size.x + capsule.size.y * 2.0f, capsule.size.y * 2.0f };
+		if (view.is_visible(bounds)) {
+			SDL_FPoint center = view.to_screen(capsule.position);
+			queues[recording].push_shape(draw_layer, draw_depth, RENDER_CAPSULE, { center.x, center.y, capsule.size.x * view.zoom, capsule.size.y * view.zoom }, colour);
+		}
+	}
 
-			SDL_RenderDrawLine(renderer, a.x, capsule.position.y - capsule.size.y, b.x, capsule.position.y - capsule.size.y);
-			SDL_RenderDrawLine(renderer, a.x, capsule.position.y + capsule.size.y, b.x, capsule.position.y + capsule.size.y);
-			SDL_RenderDrawCircleF(renderer, &a);
-			SDL_RenderDrawCircleF(renderer, &b);
+	void draw_tilemap(tilemap& map)
+	{
+		const atlas_region* sheet = atlas.get(tiles_sheet);
+		if (sheet == nullptr || sheet->texture == nullptr || tile_size.x <= 0 || tile_size.y <= 0) {
+			return;
+		}
+		if (map.baked_sheet_version != tiles_sheet_version) {
+			map.invalidate();
+			map.baked_sheet_version = tiles_sheet_version;
+		}
+		// The chunk grid is its own spatial index, only chunks under the view are looked at
+		SDL_FRect view_rect = view.get_view();
+		SDL_FRect bounds = map.get_bounds();
+		SDL_FRect first = map.get_chunk_bounds(0, 0);
+		int min_x = SDL_max(0, (int)SDL_floorf((view_rect.x - bounds.x) / first.w));
+		int min_y = SDL_max(0, (int)SDL_floorf((view_rect.y - bounds.y) / first.h));
+		int max_x = SDL_min(map.get_chunk_columns() - 1, (int)SDL_floorf((view_rect.x + view_rect.w - bounds.x) / first.w));
+		int max_y = SDL_min(map.get_chunk_rows() - 1, (int)SDL_floorf((view_rect.y + view_rect.h - bounds.y) / first.h));
+
+		for (int cy = min_y; cy <= max_y; cy++) {
+			for (int cx = min_x; cx <= max_x; cx++) {
+				tilemap::chunk& c = map.get_chunk(cx, cy);
+				if (c.used_tiles == 0) {
+					continue;
+				}
+				SDL_Point first_cell{ cx * tilemap::chunk_tiles, cy * tilemap::chunk_tiles };
+				int last_column = SDL_min(first_cell.x + tilemap::chunk_tiles, map.get_columns());
+				int last_row = SDL_min(first_cell.y + tilemap::chunk_tiles, map.get_rows());
 
+				// The blitter draws the tiles straight from the atlas, faster than SDL's software renderer scales a chunk
+				if (c.texture == nullptr && c.dirty && backend == RENDER_BACKEND_HARDWARE) {
+					// Baked at the resolution of the sheet, the chunk gets scaled to the world tile size when drawn
+					render_thread::call([&c]() {
+						c.texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET, tilemap::chunk_tiles * tile_size.x, tilemap::chunk_tiles * tile_size.y);
+						if (c.texture != nullptr) {
+							SDL_SetTextureBlendMode(c.texture, SDL_BLENDMODE_BLEND);
+						}
+					});
+				}
+				if (c.texture == nullptr) {
+					// No render target support, every tile is a sprite of its own
+					SDL_FPoint world_tile = map.get_tile_size();
+					SDL_FRect chunk_bounds = map.get_chunk_bounds(cx, cy);
+					for (int row = first_cell.y; row < last_row; row++) {
+						for (int column = first_cell.x; column < last_column; column++) {
+							if (!map.is_empty(column, row)) {
+								SDL_FRect dst{ chunk_bounds.x + (column - first_cell.x) * world_tile.x, chunk_bounds.y + (row - first_cell.y) * world_tile.y, world_tile.x, world_tile.y };
+								draw_tile(map.get(column, row), dst);
+							}
+						}
+					}
+					c.dirty = false;
+					continue;
+				}
+
+				if (c.dirty) {
+					chunk_bake bake{ c.texture, bake_copies[recording].size(), 0 };
+					for (int row = first_cell.y; row < last_row; row++) {
+						for (int column = first_cell.x; column < last_column; column++) {
+							if (map.is_empty(column, row)) {
+								continue;
+							}
+							SDL_Point tile = map.get(column, row);
+							SDL_Rect src{ sheet->rect.x + tile.x * tile_size.x, sheet->rect.y + tile.y * tile_size.y, tile_size.x, tile_size.y };
+							SDL_Rect dst{ (column - first_cell.x) * tile_size.x, (row - first_cell.y) * tile_size.y, tile_size.x, tile_size.y };
+							bake_copies[recording].push_back({ sheet->texture, src, dst });
+							bake.copy_count += 1;
+						}
+					}
+					bakes[recording].push_back(bake);
+					c.dirty = false;
+				}
+
+				SDL_FRect dst = map.get_chunk_bounds(cx, cy);
+				SDL_Rect src{ 0, 0, tilemap::chunk_tiles * tile_size.x, tilemap::chunk_tiles * tile_size.y };
+				queues[recording].push_sprite(draw_layer, draw_depth, c.texture, src, view.to_screen(dst));
+			}
 		}
-		SDL_SetRenderDrawColor(renderer, p_c.r, p_c.g, p_c.b, p_c.a);
 	}
 
 	void draw_entity(const SDL_Point& entity, const SDL_FRect& dst)
 	{
 		SDL_Rect src{ entity.x * entity_size.x, entity.y * entity_size.y, entity_size.x, entity_size.y };
-		SDL_RenderCopyF(renderer, entity_texture, &src, &dst);
+		draw_sprite(entity_sheet, src, dst);
 	}
 
 	void render_clear()
 	{
-		SDL_RenderClear(renderer);
+		// The render thread clears when it starts on the frame
+		clear_requested = true;
+	}
+
+	// Main thread, decodes changed files again in the background, the old pixels stay up until they are in
+	static void poll_changed_files()
+	{
+		if (!hot_reload) {
+			return;
+		}
+		std::vector<std::string> changed;
+		file_watcher::poll(changed);
+		for (const std::string& path : changed) {
+			auto decoded = std::make_shared<SDL_Surface*>(nullptr);
+			asset_loader::load([path, decoded]() {
+				*decoded = decode_image(path);
+			},
+			[path, decoded]() {
+				// A file caught halfway through being written fails to decode, the next write reloads it again
+				if (*decoded != nullptr) {
+					reloaded.push_back({ path, *decoded });
+				}
+			});
+		}
+	}
+
+	// Frame boundary, the render thread is idle and nothing is recorded yet that the old textures would be missing from
+	// Atlas regions are overwritten, textures swapped in their registry entry, so every handle keeps working
+	static void swap_reloaded()
+	{
+		for (auto& [path, pixels] : reloaded) {
+			auto sheet = sheets.find(path);
+			if (sheet != sheets.end() && atlas.replace(sheet->second, pixels) && sheet->second == tiles_sheet) {
+				tiles_sheet_version += 1;
+			}
+			texture_handle handle = textures.find(path.c_str());
+			texture_asset* t = textures.get(handle);
+			SDL_Texture* replacement = t != nullptr ? create_texture(SDL_DuplicateSurface(pixels)) : nullptr;
+			if (replacement != nullptr) {
+				// The frame being recorded might still have the old one in it
+				retired_textures.push_back(t->texture);
+				t->texture = replacement;
+				t->width = pixels->w;
+				t->height = pixels->h;
+				textures.set_bytes(handle, (size_t)t->width * t->height * 4);
+			}
+			SDL_FreeSurface(pixels);
+			printf("Reloaded %s\n", path.c_str());
+			damage.invalidate();
+		}
+		reloaded.clear();
+	}
+
+	void set_hot_reload(bool enabled)
+	{
+		hot_reload = enabled && file_watcher::initialise();
+		if (!hot_reload) {
+			file_watcher::shutdown();
+			for (auto& r : reloaded) {
+				SDL_FreeSurface(r.second);
+			}
+			reloaded.clear();
+			return;
+		}
+		// Whatever was loaded before it was turned on
+		for (auto& sheet : sheets) {
+			file_watcher::watch(sheet.first.c_str());
+		}
+		textures.for_each([](const std::string& path, texture_handle) {
+			file_watcher::watch(path.c_str());
+		});
+	}
+
+	// Runs on the render thread, without damage the whole target is cleared
+	static void clear_frame(const std::vector<SDL_Rect>& damaged)
+	{
+		if (damaged.empty()) {
+			SDL_RenderClear(renderer);
+			return;
+		}
+		// RenderClear ignores the clip rect, the damage gets filled with the clear colour instead
+		SDL_BlendMode previous;
+		SDL_GetRenderDrawBlendMode(renderer, &previous);
+		SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+		SDL_RenderFillRects(renderer, damaged.data(), (int)damaged.size());
+		SDL_SetRenderDrawBlendMode(renderer, previous);
+	}
+
+	// Runs on the render thread, software backends with a window copy what changed to it
+	static void present_window(const std::vector<SDL_Rect>& damaged)
+	{
+		if (damaged.empty()) {
+			SDL_BlitSurface(framebuffer, nullptr, window_surface, nullptr);
+			SDL_UpdateWindowSurface(window);
+			return;
+		}
+		for (const SDL_Rect& r : damaged) {
+			SDL_Rect dst = r;
+			SDL_BlitSurface(framebuffer, &r, window_surface, &dst);
+		}
+		SDL_UpdateWindowSurfaceRects(window, damaged.data(), (int)damaged.size());
+	}
+
+	// Main thread, returns false when the frame does not need drawing, empty damage means all of it
+	static bool find_damage(std::vector<SDL_Rect>& out_damaged)
+	{
+		out_damaged.clear();
+		if (!dirty_rendering) {
+			return true;
+		}
+#ifdef DVD_DEBUG_DRAW
+		// Debug shapes are not in the queue, the frames that have them and the first one after are drawn whole
+		bool debug_shapes = debug_draw::count() > 0;
+		if (debug_shapes || debug_drawn) {
+			damage.invalidate();
+		}
+		debug_drawn = debug_shapes;
+#endif
+		// Bakes change what a chunk sprite shows without changing the sprite
+		if (!bakes[recording].empty() || !capture_path.empty()) {
+			damage.invalidate();
+		}
+		if (!damage.update(queues[recording], out_damaged)) {
+			return false;
+		}
+		bool whole = out_damaged.size() == 1 && out_damaged[0].w == (int)view.screen_size.x && out_damaged[0].h == (int)view.screen_size.y;
+		if (whole || (backend == RENDER_BACKEND_HARDWARE && canvas == nullptr)) {
+			out_damaged.clear();
+		}
+		return true;
 	}
 
 	void render_present()
 	{
-		SDL_RenderPresent(renderer);
+		// The queue about to be recorded into was submitted by the previous frame, it has to be done with it
+		render_thread::wait_idle();
+		free_retired_textures();
+		poll_changed_files();
+		// Finished loads land in the atlas before the frame is handed over, so the upload takes them along
+		asset_loader::poll();
+		swap_reloaded();
+		if (first_frame_submitted && !startup_timer::is_finished() && asset_loader::get_pending_count() == 0) {
+			startup_timer::finish();
+		}
+		std::vector<SDL_Rect> damaged;
+		if (!find_damage(damaged)) {
+			// Same commands as the frame on screen, nothing to draw or present
+			queues[recording].clear();
+			clear_requested = false;
+			retired_in_flight.swap(retired_textures);
+			DVD_DEBUG_SWAP();
+			frame_pacer::end_frame(false);
+			return;
+		}
+		DVD_DEBUG_SWAP();
+		int submitted = recording;
+		bool clear = clear_requested;
+		recording ^= 1;
+		clear_requested = false;
+		std::string capture = capture_path;
+		capture_format format = capture_as;
+		capture_path.clear();
+
+		bool first_frame = !first_frame_submitted;
+		first_frame_submitted = true;
+		render_thread::submit_frame([submitted, clear, capture, format, damaged, first_frame]() {
+			// Glyphs get added to the atlas lazily, their pixels have to be on the GPU before the queue or the bakes use them
+			// The software backend blits straight from the atlas pixels
+			if (framebuffer == nullptr) {
+				atlas.upload();
+			}
+			// Chunks are baked before the clear, switching targets back and forth could lose it on some backends
+			bake_chunks(submitted);
+			if (canvas != nullptr) {
+				SDL_SetRenderTarget(renderer, canvas);
+			}
+			if (clear) {
+				clear_frame(damaged);
+			}
+			queues[submitted].submit(renderer, framebuffer, damaged.data(), (int)damaged.size());
+			if (canvas != nullptr) {
+				SDL_SetRenderTarget(renderer, nullptr);
+				SDL_RenderCopy(renderer, canvas, nullptr, nullptr);
+			}
+			// Debug shapes always end up on top of the frame
+			DVD_DEBUG_FLUSH(renderer);
+			if (hashing || !capture.empty()) {
+				// The back buffer is undefined after presenting, so the frame is read before
+				SDL_Surface* frame = read_frame();
+				if (hashing) {
+					frame_hash = frame_capture::hash(frame);
+				}
+				if (!capture.empty()) {
+					frame_capture::save(frame, capture.c_str(), format);
+				}
+				if (frame != framebuffer) {
+					SDL_FreeSurface(frame);
+				}
+			}
+			SDL_RenderPresent(renderer);
+			if (window_surface != nullptr) {
+				present_window(damaged);
+			}
+			if (first_frame) {
+				startup_timer::record("first frame", initialised_at);
+			}
+		});
+		retired_in_flight.swap(retired_textures);
+		frame_pacer::end_frame();
+	}
+
+	void set_dirty_rendering(bool enabled)
+	{
+		render_thread::wait_idle();
+		dirty_rendering = enabled;
+		damage.invalidate();
+		if (backend != RENDER_BACKEND_HARDWARE) {
+			// The framebuffer keeps its pixels between frames already
+			return;
+		}
+		render_thread::call([enabled]() {
+			if (enabled && canvas == nullptr) {
+				int width;
+				int height;
+				SDL_GetRendererOutputSize(renderer, &width, &height);
+				canvas = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET, width, height);
+				if (canvas != nullptr) {
+					SDL_SetTextureBlendMode(canvas, SDL_BLENDMODE_NONE);
+				}
+			}
+			else if (!enabled && canvas != nullptr) {
+				SDL_DestroyTexture(canvas);
+				canvas = nullptr;
+			}
+		});
+		if (enabled && canvas == nullptr) {
+			printf("No render target for dirty rendering, changed frames are drawn whole: %s\n", SDL_GetError());
+		}
+	}
+
+	void invalidate_frame()
+	{
+		damage.invalidate();
+	}
+
+	void set_frame_pacing(frame_pacing mode, double target_fps)
+	{
+		bool vsync = false;
+		if (mode == FRAME_PACING_VSYNC && backend == RENDER_BACKEND_HARDWARE) {
+			render_thread::call([&vsync]() {
+				vsync = SDL_RenderSetVSync(renderer, 1) == 0;
+			});
+		}
+		else if (backend == RENDER_BACKEND_HARDWARE) {
+			render_thread::call([]() {
+				SDL_RenderSetVSync(renderer, 0);
+			});
+		}
+
+		if (mode == FRAME_PACING_VSYNC) {
+			// The refresh rate is also how long a skipped frame waits in vsync mode
+			SDL_DisplayMode display;
+			int display_index = window != nullptr ? SDL_GetWindowDisplayIndex(window) : 0;
+			bool known = SDL_GetCurrentDisplayMode(SDL_max(display_index, 0), &display) == 0 && display.refresh_rate > 0;
+			target_fps = known ? display.refresh_rate : 60.0;
+		}
+		if (mode == FRAME_PACING_VSYNC && !vsync) {
+			mode = FRAME_PACING_TARGET;
+			printf("No vsync on this backend, pacing to %.0f fps instead\n", target_fps);
+		}
+		frame_pacer::set_mode(mode, target_fps);
+	}
+
+	void capture_next_frame(const char* path, capture_format format)
+	{
+		capture_path = path != nullptr ? path : "";
+		capture_as = format;
+	}
+
+	void set_frame_hashing(bool enabled)
+	{
+		// The render thread reads it mid frame
+		render_thread::wait_idle();
+		hashing = enabled;
+		frame_hash = 0;
+	}
+
+	Uint64 get_frame_hash()
+	{
+		render_thread::wait_idle();
+		return frame_hash;
 	}
 }
 
@@ -0,0 +1,113 @@
+#include "file_watcher.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <unordered_map>
+
+#ifdef __linux__
+#include <errno.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+static int descriptor{ -1 };
+// Watched files by the descriptor of their directory watch and their name
+static std::unordered_map<std::string, std::string> files;
+
+static std::string get_key(int watch, const char* name)
+{
+	return std::to_string(watch) + "/" + name;
+}
+
+bool file_watcher::initialise()
+{
+	if (descriptor >= 0) {
+		return true;
+	}
+	descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (descriptor < 0) {
+		printf("Could not start watching files, errno %d\n", errno);
+		return false;
+	}
+	return true;
+}
+
+void file_watcher::shutdown()
+{
+	if (descriptor >= 0) {
+		close(descriptor);
+	}
+	descriptor = -1;
+	files.clear();
+}
+
+bool file_watcher::is_running()
+{
+	return descriptor >= 0;
+}
+
+void file_watcher::watch(const char* path)
+{
+	if (descriptor < 0) {
+		return;
+	}
+	std::string file = path;
+	size_t slash = file.find_last_of('/');
+	std::string directory = slash == std::string::npos ? "." : file.substr(0, slash);
+	std::string name = slash == std::string::npos ? file : file.substr(slash + 1);
+	// The same directory gives back the same watch, adding it again is harmless
+	int watch = inotify_add_watch(descriptor, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+	if (watch < 0) {
+		printf("Could not watch %s, errno %d\n", directory.c_str(), errno);
+		return;
+	}
+	files[get_key(watch, name.c_str())] = file;
+}
+
+void file_watcher::poll(std::vector<std::string>& out_changed)
+{
+	if (descriptor < 0) {
+		return;
+	}
+	alignas(inotify_event) char buffer[4096];
+	while (true) {
+		ssize_t length = read(descriptor, buffer, sizeof(buffer));
+		if (length <= 0) {
+			// EAGAIN, everything that happened so far is read
+			break;
+		}
+		for (ssize_t offset = 0; offset < length;) {
+			const inotify_event* event = (const inotify_event*)(buffer + offset);
+			offset += sizeof(inotify_event) + event->len;
+			if (event->len == 0) {
+				continue;
+			}
+			auto found = files.find(get_key(event->wd, event->name));
+			if (found != files.end() && std::find(out_changed.begin(), out_changed.end(), found->second) == out_changed.end()) {
+				out_changed.push_back(found->second);
+			}
+		}
+	}
+}
+#else
+bool file_watcher::initialise()
+{
+	return false;
+}
+
+void file_watcher::shutdown()
+{
+}
+
+bool file_watcher::is_running()
+{
+	return false;
+}
+
+void file_watcher::watch(const char*)
+{
+}
+
+void file_watcher::poll(std::vector<std::string>&)
+{
+}
+#endif
@@ -0,0 +1,55 @@
+#include "frame_capture.h"
+
+#include <stdio.h>
+#include <SDL/SDL.h>
+#include <SDL/SDL_image.h>
+
+#define FNV_OFFSET_BASIS 14695981039346656037ull
+#define FNV_PRIME 1099511628211ull
+
+Uint64 frame_capture::hash(const SDL_Surface* frame)
+{
+	Uint64 h = FNV_OFFSET_BASIS;
+	if (frame == nullptr) {
+		return h;
+	}
+	int row_bytes = frame->w * frame->format->BytesPerPixel;
+	for (int y = 0; y < frame->h; y++) {
+		const Uint8* row = (const Uint8*)frame->pixels + y * frame->pitch;
+		for (int i = 0; i < row_bytes; i++) {
+			h = (h ^ row[i]) * FNV_PRIME;
+		}
+	}
+	return h;
+}
+
+static bool save_raw(SDL_Surface* frame, const char* path)
+{
+	SDL_Surface* converted = SDL_ConvertSurfaceFormat(frame, SDL_PIXELFORMAT_RGBA32, 0);
+	if (converted == nullptr) {
+		return false;
+	}
+	FILE* file = fopen(path, "wb");
+	bool written = file != nullptr;
+	for (int y = 0; written && y < converted->h; y++) {
+		const Uint8* row = (const Uint8*)converted->pixels + y * converted->pitch;
+		written = fwrite(row, 4, converted->w, file) == (size_t)converted->w;
+	}
+	if (file != nullptr) {
+		fclose(file);
+	}
+	SDL_FreeSurface(converted);
+	return written;
+}
+
+bool frame_capture::save(SDL_Surface* frame, const char* path, capture_format format)
+{
+	if (frame == nullptr || path == nullptr) {
+		return false;
+	}
+	bool saved = format == CAPTURE_RAW ? save_raw(frame, path) : IMG_SavePNG(frame, path) == 0;
+	if (!saved) {
+		printf("Could not save frame to %s: %s\n", path, SDL_GetError());
+	}
+	return saved;
+}
@@ -0,0 +1,151 @@
+#include "frame_pacer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <SDL/SDL.h>
+
+// Sleeping stops this far before the deadline, grows with the worst oversleep seen and slowly shrinks again
+#define MINIMUM_SLEEP_MARGIN_MS 0.5
+#define MAXIMUM_SLEEP_MARGIN_MS 4.0
+#define SLEEP_MARGIN_DECAY 0.99
+
+struct pacer_sample
+{
+	double frame_ms;
+	double jitter_ms;
+	double sleep_ms;
+	double spin_ms;
+};
+
+static frame_pacing mode{ FRAME_PACING_UNCAPPED };
+static double target_fps{ 60.0 };
+static double sleep_margin_ms{ 2.0 };
+
+static Uint64 last_end{ 0 };
+static Uint64 deadline{ 0 };
+
+static pacer_sample samples[frame_pacer::window];
+static size_t head{ 0 };
+static size_t count{ 0 };
+
+static double to_ms(Uint64 ticks)
+{
+	return ticks * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+static Uint64 to_ticks(double ms)
+{
+	return (Uint64)(ms * SDL_GetPerformanceFrequency() / 1000.0);
+}
+
+// Returns at the deadline or a little after, the sleep and spin it took go into the sample
+static void wait_until(Uint64 until, pacer_sample& sample)
+{
+	Uint64 start = SDL_GetPerformanceCounter();
+	double remaining = until > start ? to_ms(until - start) : 0.0;
+	if (remaining > sleep_margin_ms + 1.0) {
+		Uint32 requested = (Uint32)(remaining - sleep_margin_ms);
+		SDL_Delay(requested);
+		Uint64 woke = SDL_GetPerformanceCounter();
+		double slept = to_ms(woke - start);
+		double oversleep = slept - requested;
+		sleep_margin_ms = SDL_clamp(SDL_max(sleep_margin_ms * SLEEP_MARGIN_DECAY, oversleep + 0.25), MINIMUM_SLEEP_MARGIN_MS, MAXIMUM_SLEEP_MARGIN_MS);
+		sample.sleep_ms = slept;
+		start = woke;
+	}
+	Uint64 now = start;
+	while (now < until) {
+		now = SDL_GetPerformanceCounter();
+	}
+	sample.spin_ms = to_ms(now - start);
+}
+
+void frame_pacer::set_mode(frame_pacing pacing, double fps)
+{
+	mode = pacing;
+	target_fps = fps > 0.0 ? fps : 60.0;
+	// The next frame starts the schedule over
+	deadline = 0;
+}
+
+frame_pacing frame_pacer::get_mode()
+{
+	return mode;
+}
+
+double frame_pacer::get_target_fps()
+{
+	return target_fps;
+}
+
+void frame_pacer::end_frame(bool presented)
+{
+	pacer_sample sample{ 0.0, 0.0, 0.0, 0.0 };
+	Uint64 now = SDL_GetPerformanceCounter();
+	if (mode == FRAME_PACING_TARGET) {
+		Uint64 period = to_ticks(1000.0 / target_fps);
+		deadline = deadline == 0 ? now + period : deadline + period;
+		if (now > deadline + period) {
+			// A whole frame behind, start over from here instead of rushing frames out to catch up
+			deadline = now;
+		}
+		wait_until(deadline, sample);
+		Uint64 released = SDL_GetPerformanceCounter();
+		sample.jitter_ms = to_ms(released - deadline);
+	}
+	else if (mode == FRAME_PACING_VSYNC && !presented && last_end != 0) {
+		// Nothing waited for the display this frame, so wait as long as it would have
+		Uint64 until = last_end + to_ticks(1000.0 / target_fps);
+		wait_until(until, sample);
+		Uint64 released = SDL_GetPerformanceCounter();
+		sample.jitter_ms = released > until ? to_ms(released - until) : 0.0;
+	}
+
+	Uint64 end = SDL_GetPerformanceCounter();
+	if (last_end != 0) {
+		sample.frame_ms = to_ms(end - last_end);
+		samples[head] = sample;
+		head = (head + 1) % window;
+		count = SDL_min(count + 1, window);
+	}
+	last_end = end;
+}
+
+frame_pacer::stats frame_pacer::get_stats()
+{
+	stats s{ count, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+	if (count == 0) {
+		return s;
+	}
+	s.min_ms = samples[0].frame_ms;
+	for (size_t i = 0; i < count; i++) {
+		const pacer_sample& p = samples[i];
+		s.average_ms += p.frame_ms;
+		s.min_ms = SDL_min(s.min_ms, p.frame_ms);
+		s.max_ms = SDL_max(s.max_ms, p.frame_ms);
+		s.average_jitter_ms += p.jitter_ms;
+		s.max_jitter_ms = SDL_max(s.max_jitter_ms, p.jitter_ms);
+		s.average_sleep_ms += p.sleep_ms;
+		s.average_spin_ms += p.spin_ms;
+	}
+	s.average_ms /= count;
+	s.average_jitter_ms /= count;
+	s.average_sleep_ms /= count;
+	s.average_spin_ms /= count;
+	for (size_t i = 0; i < count; i++) {
+		double d = samples[i].frame_ms - s.average_ms;
+		s.deviation_ms += d * d;
+	}
+	s.deviation_ms = sqrt(s.deviation_ms / count);
+	return s;
+}
+
+void frame_pacer::print()
+{
+	static const char* mode_names[] = { "uncapped", "vsync", "target" };
+	stats s = get_stats();
+	printf("%-10s %8s %10s %10s %10s %10s %10s %10s %10s %10s\n", "pacing", "fps", "avg ms", "min ms", "max ms", "dev ms", "jitter", "max jit", "sleep ms", "spin ms");
+	printf("%-10s %8.1f %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+		mode_names[mode], s.average_ms > 0.0 ? 1000.0 / s.average_ms : 0.0, s.average_ms, s.min_ms, s.max_ms, s.deviation_ms,
+		s.average_jitter_ms, s.max_jitter_ms, s.average_sleep_ms, s.average_spin_ms);
+}
@@ -0,0 +1,126 @@
+#include "glyph_cache.h"
+
+#include <math.h>
+#include <SDL/SDL.h>
+#include "sdf_font.h"
+#include "render_queue.h"
+
+#define MINIMUM_GLYPH_PIXEL_HEIGHT 4.0f
+#define MAXIMUM_GLYPH_PIXEL_HEIGHT 512.0f
+
+// The only heights glyphs are resolved at, everything in between scales the next one up down
+// Keeps the atlas at a dozen sizes however text gets animated, and shrinking a glyph looks better than growing it
+static const int resolved_heights[] = { 8, 12, 16, 24, 32, 48, 64, 96, 128, 192, 256, 384, 512 };
+
+static float to_pixel_height(float pixel_height)
+{
+	return SDL_clamp(pixel_height, MINIMUM_GLYPH_PIXEL_HEIGHT, MAXIMUM_GLYPH_PIXEL_HEIGHT);
+}
+
+static int to_resolved_height(float pixel_height)
+{
+	for (int height : resolved_heights) {
+		if (pixel_height <= height) {
+			return height;
+		}
+	}
+	return resolved_heights[SDL_arraysize(resolved_heights) - 1];
+}
+
+void glyph_cache::create(const sdf_font* cache_font, texture_atlas* cache_atlas)
+{
+	destroy();
+	font = cache_font;
+	atlas = cache_atlas;
+}
+
+void glyph_cache::destroy()
+{
+	// The atlas owns the pixels, forgetting the lookups is enough
+	resolved.clear();
+	font = nullptr;
+}
+
+atlas_handle glyph_cache::get(unsigned char character, int pixel_height)
+{
+	int key = (pixel_height << 8) | character;
+	auto it = resolved.find(key);
+	if (it != resolved.end()) {
+		return it->second;
+	}
+
+	SDL_Surface* surface = character != ' ' ? font->resolve(character, (float)pixel_height) : nullptr;
+	atlas_handle handle = atlas->add(surface);
+	SDL_FreeSurface(surface);
+	resolved[key] = handle;
+	return handle;
+}
+
+SDL_FPoint glyph_cache::measure(const char* text, float pixel_height) const
+{
+	if (font == nullptr || !font->is_baked()) {
+		return { 0.0f, 0.0f };
+	}
+	float scale = to_pixel_height(pixel_height) / (float)font->get_base_height();
+	int width = 0;
+	unsigned char previous = 0;
+	for (const unsigned char* c = (const unsigned char*)text; *c != '\0'; c++) {
+		const sdf_font::glyph* g = font->get(*c);
+		if (g == nullptr) {
+			continue;
+		}
+		width += font->get_kerning(previous, *c) + g->advance;
+		previous = *c;
+	}
+	return { width * scale, to_pixel_height(pixel_height) };
+}
+
+void glyph_cache::draw(const char* text, const SDL_FRect& dst, SDL_Colour colour, render_queue& queue, int layer, int depth)
+{
+	float pixel_height = to_pixel_height(dst.h);
+	SDL_FPoint size = measure(text, pixel_height);
+	if (size.x <= 0.0f) {
+		return;
+	}
+	draw_scaled(text, { dst.x, dst.y }, pixel_height, dst.w / size.x, dst.h / pixel_height, colour, queue, layer, depth);
+}
+
+void glyph_cache::draw(const char* text, const SDL_FPoint& position, float pixel_height, SDL_Colour colour, render_queue& queue, int layer, int depth)
+{
+	draw_scaled(text, position, to_pixel_height(pixel_height), 1.0f, 1.0f, colour, queue, layer, depth);
+}
+
+void glyph_cache::draw_scaled(const char* text, const SDL_FPoint& position, float pixel_height, float stretch_x, float stretch_y, SDL_Colour colour, render_queue& queue, int layer, int depth)
+{
+	if (font == nullptr || atlas == nullptr || !font->is_baked()) {
+		return;
+	}
+	float scale = pixel_height / (float)font->get_base_height();
+	int resolved_height = to_resolved_height(pixel_height);
+	// From the resolved glyphs to the height asked for
+	float shrink = pixel_height / resolved_height;
+	// The fields carry their spread above the line, move the quads up to compensate
+	float top = position.y - font->get_spread() * scale * stretch_y;
+
+	float pen = 0.0f;
+	unsigned char previous = 0;
+	for (const unsigned char* c = (const unsigned char*)text; *c != '\0'; c++) {
+		const sdf_font::glyph* g = font->get(*c);
+		if (g == nullptr) {
+			continue;
+		}
+		pen += font->get_kerning(previous, *c) * scale;
+		const atlas_region* region = atlas->get(get(*c, resolved_height));
+		if (region != nullptr) {
+			SDL_FRect quad{
+				position.x + (pen + g->offset_x * scale) * stretch_x,
+				top,
+				region->rect.w * shrink * stretch_x,
+				region->rect.h * shrink * stretch_y
+			};
+			queue.push_sprite(layer, depth, region->texture, region->rect, quad, colour);
+		}
+		pen += g->advance * scale;
+		previous = *c;
+	}
+}
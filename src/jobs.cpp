@@ -0,0 +1,205 @@
+#include "jobs.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct job
+{
+	jobs::function function;
+	jobs::counter* signal;
+};
+
+struct job_queue
+{
+	std::mutex mutex;
+	std::deque<job> deque;
+};
+
+// Queue 0 belongs to every thread outside of the pool (main thread mostly), 1..n to the workers
+static std::vector<job_queue*> queues;
+static std::vector<std::thread> workers;
+
+static std::mutex sleep_mutex;
+static std::condition_variable sleep_condition;
+static std::atomic<int> queued{ 0 };
+static std::atomic<bool> stopping{ false };
+
+static thread_local size_t queue_index{ 0 };
+
+static void push(size_t index, const job& j)
+{
+	job_queue* queue = queues[index];
+	{
+		std::lock_guard<std::mutex> lock(queue->mutex);
+		queue->deque.push_back(j);
+	}
+	queued += 1;
+	sleep_condition.notify_one();
+}
+
+static bool pop_own(size_t index, job& out)
+{
+	job_queue* queue = queues[index];
+	std::lock_guard<std::mutex> lock(queue->mutex);
+	if (queue->deque.empty()) {
+		return false;
+	}
+	out = std::move(queue->deque.back());
+	queue->deque.pop_back();
+	queued -= 1;
+	return true;
+}
+
+static bool steal(size_t thief, job& out)
+{
+	for (size_t i = 1; i < queues.size(); i++) {
+		job_queue* queue = queues[(thief + i) % queues.size()];
+		std::unique_lock<std::mutex> lock(queue->mutex, std::try_to_lock);
+		if (!lock.owns_lock() || queue->deque.empty()) {
+			continue;
+		}
+		out = std::move(queue->deque.front());
+		queue->deque.pop_front();
+		queued -= 1;
+		return true;
+	}
+	return false;
+}
+
+// The last decrement and taking the waiting jobs happen under the lock, wait takes it too before it returns,
+// so once the count is zero no worker touches the counter again and the owner can let it go
+static void finish(jobs::counter* c)
+{
+	std::vector<jobs::function> ready;
+	{
+		std::lock_guard<std::mutex> lock(c->mutex);
+		if (--c->value == 0) {
+			ready.swap(c->waiting);
+		}
+	}
+	for (auto& enqueue : ready) {
+		enqueue();
+	}
+}
+
+// Runs at most one job, returns false when nothing was runnable
+static bool try_execute(size_t index)
+{
+	job j;
+	if (!pop_own(index, j) && !steal(index, j)) {
+		return false;
+	}
+	j.function();
+	if (j.signal != nullptr) {
+		finish(j.signal);
+	}
+	return true;
+}
+
+static void worker_loop(size_t index)
+{
+	queue_index = index;
+	while (!stopping) {
+		if (try_execute(index)) {
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(sleep_mutex);
+		sleep_condition.wait_for(lock, std::chrono::milliseconds(1), []() { return queued.load() > 0 || stopping.load(); });
+	}
+}
+
+void jobs::initialise(int worker_count)
+{
+	if (!queues.empty()) {
+		return;
+	}
+	if (worker_count < 0) {
+		int hardware = (int)std::thread::hardware_concurrency();
+		worker_count = hardware > 1 ? hardware - 1 : 0;
+	}
+
+	stopping = false;
+	for (int i = 0; i < worker_count + 1; i++) {
+		queues.push_back(new job_queue);
+	}
+	for (int i = 0; i < worker_count; i++) {
+		workers.emplace_back(worker_loop, (size_t)i + 1);
+	}
+}
+
+void jobs::shutdown()
+{
+	stopping = true;
+	sleep_condition.notify_all();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	workers.clear();
+	for (auto queue : queues) {
+		delete queue;
+	}
+	queues.clear();
+	queued = 0;
+}
+
+int jobs::get_worker_count()
+{
+	return (int)workers.size();
+}
+
+void jobs::run(const function& function, counter* signal, counter* dependency)
+{
+	if (queues.empty()) {
+		// Not initialised, behave like a plain function call
+		if (dependency != nullptr) {
+			wait(dependency);
+		}
+		function();
+		return;
+	}
+	if (signal != nullptr) {
+		signal->value += 1;
+	}
+	job j{ function, signal };
+	if (dependency != nullptr) {
+		// Jobs that can not run yet stay out of the queues, idle workers would spin on them otherwise
+		std::lock_guard<std::mutex> lock(dependency->mutex);
+		if (dependency->value.load() > 0) {
+			dependency->waiting.push_back([j]() { push(queue_index, j); });
+			return;
+		}
+	}
+	push(queue_index, j);
+}
+
+void jobs::wait(counter* c)
+{
+	while (c->value.load() > 0) {
+		if (queues.empty() || !try_execute(queue_index)) {
+			std::this_thread::yield();
+		}
+	}
+	// The worker that brought it to zero might still hold the lock, it is done with the counter once it let go
+	std::lock_guard<std::mutex> lock(c->mutex);
+}
+
+void jobs::parallel_for(size_t count, size_t batch_size, const range_function& body)
+{
+	if (count == 0) {
+		return;
+	}
+	if (batch_size == 0) {
+		size_t threads = (size_t)get_worker_count() + 1;
+		batch_size = (count + threads - 1) / threads;
+	}
+
+	counter done;
+	for (size_t begin = 0; begin < count; begin += batch_size) {
+		size_t end = begin + batch_size < count ? begin + batch_size : count;
+		run([&body, begin, end]() { body(begin, end); }, &done);
+	}
+	wait(&done);
+}
@@ -6,9 +6,14 @@
 #include <vector>
 #include<string>
 
+#include "arena.h"
 #include "engine.h"
+#include "debug_draw.h"
 #include "input.h"
 #include "events.h"
+#include "profiler.h"
+#include "spatial_grid.h"
+#include "tilemap.h"
 #include <math.h>
 
 #define SCREEN_WIDTH 800
@@ -16,72 +21,7 @@
 
 float delta_time = 0.0f;
 
-typedef unsigned char DVD_byte;
-typedef size_t DVD_entity;
-typedef size_t DVD_component_id;
-
-// Invalid entity is 0 should cause a lot of cool out of the box behaviour
-#define INVALID_ENTITY 0
-#define INVALID_COMPONENT size_t(~0)
-
-#define MAXIMUM_ENTITIES 256
-#define MAXIMUM_UPDATE_SYSTEMS 64
-#define MAXIMUM_RENDER_SYSTEMS 32
-
-// Entity
-size_t DVD_entities_available_pivot{ MAXIMUM_ENTITIES };
-DVD_entity DVD_entities_available[MAXIMUM_ENTITIES];
-
-size_t DVD_entities_used_pivot{ 0 };
-DVD_entity DVD_entities_used[MAXIMUM_ENTITIES];
-
-bool DVD_entity_used_lookup[MAXIMUM_ENTITIES];
-
-// Header
-bool DVD_entity_is_valid(DVD_entity e);
-void DVD_components_control_try_initialise(DVD_component_id component_index, DVD_byte* buffer_begin, size_t buffer_element_size);
-void DVD_components_control_set_valid(DVD_entity e, DVD_component_id component_index, bool is_valid);
-bool DVD_components_control_is_valid(DVD_entity e, DVD_component_id component_index);
-
-#define COMPONENT(custom_namespace, type, name) \
-type DVD_internal_##name##_buffer[MAXIMUM_ENTITIES]; \
-const DVD_component_id custom_namespace##_##name##_id{ GET_COUNT_AND_INCREMENT }; \
-inline bool custom_namespace##_##name##_exists(const DVD_entity e) \
-{ \
-	if (!DVD_entity_is_valid(e) || custom_namespace##_##name##_id == INVALID_COMPONENT) { \
-		return false; \
-	} \
-	return DVD_components_control_is_valid(e, custom_namespace##_##name##_id); \
-} \
-inline void custom_namespace##_##name##_set(const DVD_entity e, const type v) \
-{ \
-	if (DVD_entity_is_valid(e)) { \
-		DVD_components_control_try_initialise(custom_namespace##_##name##_id, (DVD_byte*)(DVD_internal_##name##_buffer), sizeof(type)); \
-		DVD_components_control_set_valid(e, custom_namespace##_##name##_id, true); \
-		DVD_internal_##name##_buffer[e] = v; \
-	} \
-	else { \
-		printf("Error in %s of type %s", #name, #type); \
-	} \
-} \
-inline type* custom_namespace##_##name##_get(const DVD_entity e) \
-{ \
-	return &DVD_internal_##name##_buffer[e]; \
-} \
-inline void custom_namespace##_##name##_destroy(const DVD_entity e) \
-{ \
-	if (!DVD_entity_is_valid(e) || custom_namespace##_##name##_id == INVALID_COMPONENT) { \
-		DVD_components_control_set_valid(e, custom_namespace##_##name##_id, false); \
-	} \
-} \
-
-// User:
-// Encapsulate all used components with COMPONENT_AREA_START and COMPONENT_AREA_END to count all used components
-// otherwise, if you are lazy, just define MAXIMUM_COMPONENTS with a hardcoded value by yourself
-#define COMPONENT_AREA_START enum COUNTER_BASE { COUNTER_BASE_VALUE = __COUNTER__ };
-#define GET_COUNT_AND_INCREMENT (__COUNTER__ - COUNTER_BASE_VALUE - 1)
-#define COMPONENT_AREA_END enum COMPONENT_COUNT { COMPONENT_COUNT_VALUE = GET_COUNT_AND_INCREMENT };
-#define MAXIMUM_COMPONENTS COMPONENT_COUNT_VALUE
+#include "dvd.h"
 
 // User-defined structs
 struct controller
@@ -101,7 +41,17 @@ enum sprite_type
 	SPRITE_TYPE_TILE
 };
 
+// Render layers, bottom to top
+enum draw_layer
+{
+	DRAW_LAYER_TILES = 64,
+	DRAW_LAYER_ENTITIES = DEFAULT_DRAW_LAYER,
+	DRAW_LAYER_UI = 192
+};
+
 typedef void(*button_event)();
+// COMPONENT puts const in front of the type, a plain tilemap* would turn into a pointer to const
+typedef tilemap* tilemap_pointer;
 
 // User-defined Components implementation and interface generation (Optional, but convenient)
 COMPONENT_AREA_START
@@ -125,355 +75,127 @@ COMPONENT(gameplay, SDL_FRect, button_text_padding);
 COMPONENT(gameplay, SDL_Colour, unhover_colour);
 COMPONENT(gameplay, SDL_Colour, hover_colour);
 COMPONENT(gameplay, button_event, button_event);
+COMPONENT(gameplay, SDL_Point, tile_cell);
+COMPONENT(gameplay, tilemap_pointer, tiles);
+// Whatever can move has this, everything else goes into the visibility grid once when the scene is loaded
+COMPONENT(gameplay, bool, moves);
 // ...
 COMPONENT_AREA_END
 
-// Separate into header
-// In static storage (.cpp/.c)
-size_t DVD_components_buffer_element_size_lookup[MAXIMUM_COMPONENTS]{ 0 };
-DVD_byte* DVD_components_buffer_begin_lookup[MAXIMUM_COMPONENTS]{ nullptr };
-bool DVD_components_valid_lookup[MAXIMUM_ENTITIES * MAXIMUM_COMPONENTS]{ false };
+#include "dvd_ecs.h"
 
-bool DVD_components_control_is_initialised(DVD_component_id component_index)
+void DVD_systems_run()
 {
-	return DVD_components_buffer_element_size_lookup[component_index] != 0;
+	DVD_PROFILE_FRAME_BEGIN();
+	DVD_systems_run_update();
+
+	engine::render_clear();
+	DVD_systems_run_render();
+	engine::render_present();
+	DVD_PROFILE_FRAME_END();
 }
-void DVD_components_control_initialise(DVD_component_id component_index, DVD_byte* buffer_begin, size_t buffer_element_size)
+
+// Everything with bounds sits in the grid, render systems only get to see what the camera sees
+spatial_grid visibility_grid;
+
+bool entity_bounds(DVD_entity e, SDL_FRect& out_bounds)
 {
-	if (component_index >= MAXIMUM_COMPONENTS) {
-		// Error here
-		return;
+	bool found = false;
+	auto merge = [&](const SDL_FRect& r) {
+		if (!found) {
+			out_bounds = r;
+			found = true;
+			return;
+		}
+		float right = SDL_max(out_bounds.x + out_bounds.w, r.x + r.w);
+		float bottom = SDL_max(out_bounds.y + out_bounds.h, r.y + r.h);
+		out_bounds.x = SDL_min(out_bounds.x, r.x);
+		out_bounds.y = SDL_min(out_bounds.y, r.y);
+		out_bounds.w = right - out_bounds.x;
+		out_bounds.h = bottom - out_bounds.y;
+	};
+	if (gameplay_position_exists(e) && gameplay_size_exists(e)) {
+		SDL_FPoint p = *gameplay_position_get(e);
+		SDL_FPoint s = *gameplay_size_get(e);
+		merge({ p.x, p.y, s.x, s.y });
 	}
-	DVD_components_buffer_element_size_lookup[component_index] = buffer_element_size;
-	DVD_components_buffer_begin_lookup[component_index] = buffer_begin;
-}
-void DVD_components_control_try_initialise(DVD_component_id component_index, DVD_byte* buffer_begin, size_t buffer_element_size)
-{
-	if (!DVD_components_control_is_initialised(component_index)) {
-		DVD_components_control_initialise(component_index, buffer_begin, buffer_element_size);
+	if (gameplay_rect_collider_exists(e)) {
+		merge(*gameplay_rect_collider_get(e));
 	}
-}
-void DVD_components_control_set_valid(DVD_entity e, DVD_component_id component_index, bool is_valid)
-{
-	if (component_index >= MAXIMUM_COMPONENTS) {
-		// Error here
-		return; 
+	if (gameplay_circle_collider_exists(e)) {
+		SDL_FCircle c = *gameplay_circle_collider_get(e);
+		merge({ c.x - c.radius, c.y - c.radius, c.radius * 2.0f, c.radius * 2.0f });
 	}
-	DVD_components_valid_lookup[e * MAXIMUM_COMPONENTS + component_index] = is_valid;
-}
-bool DVD_components_control_is_valid(DVD_entity e, DVD_component_id component_index)
-{
-	return DVD_components_valid_lookup[e * MAXIMUM_COMPONENTS + component_index];
-}
-void DVD_components_single_copy(DVD_component_id component_index, DVD_entity from, DVD_entity to)
-{
-	if (DVD_components_control_is_initialised(component_index)) {
-		size_t element_size = DVD_components_buffer_element_size_lookup[component_index];
-		DVD_byte* start = DVD_components_buffer_begin_lookup[component_index];
-		DVD_byte* src_data = (start)+(from * element_size);
-		DVD_byte* dst_data = (start)+(to * element_size);
-		memcpy(dst_data, src_data, element_size);
-		DVD_components_control_set_valid(to, component_index, DVD_components_control_is_valid(from, component_index));
+	if (gameplay_capsule_collider_exists(e)) {
+		SDL_FHorizontalCapsule c = *gameplay_capsule_collider_get(e);
+		merge({ c.position.x - c.size.x * 0.5f - c.size.y, c.position.y - c.size.y, c.size.x + c.size.y * 2.0f, c.size.y * 2.0f });
 	}
-}
-void DVD_components_entities_deep_copy(DVD_entity from, DVD_entity to)
-{
-	for (int i = 0; i < MAXIMUM_COMPONENTS; i++) {
-		DVD_components_single_copy(i, from, to);
+	if (gameplay_tiles_exists(e)) {
+		merge((*gameplay_tiles_get(e))->get_bounds());
 	}
+	return found;
 }
 
-struct DVD_signature
-{
-	bool field[MAXIMUM_COMPONENTS]; 
-	size_t count;
-};
-struct DVD_filter
-{
-	DVD_entity list[MAXIMUM_ENTITIES];
-	size_t count;
-};
-void DVD_entities_initialise()
-{
-	for (int i = 0; i < MAXIMUM_ENTITIES; i++) {
-		DVD_entities_available[i] = i;
-		DVD_entities_used[i] = INVALID_ENTITY;
-	}
-}
-bool DVD_entity_is_valid(DVD_entity e)
+void visibility_update_system(DVD_entity e)
 {
-	return e < MAXIMUM_ENTITIES && e != INVALID_ENTITY && DVD_entity_used_lookup[e];
-}
-DVD_signature DVD_signature_create_from_entity(const DVD_entity e)
-{
-	bool* start = &DVD_components_valid_lookup[e * MAXIMUM_COMPONENTS + 0];
-
-	DVD_signature signature{ {}, 0 };
-	memset(signature.field, 0, sizeof(signature.field));
-	for (int i = 0; i < MAXIMUM_COMPONENTS; i++) {
-		signature.field[i] = start[i];
-		signature.count = SDL_max(signature.count, i + 1);
+	SDL_FRect bounds;
+	if (entity_bounds(e, bounds)) {
+		visibility_grid.update(e, bounds);
 	}
-	return signature;
-}
-DVD_signature DVD_signature_create_intersection_with_entity(const DVD_entity e, size_t count, ...)
-{
-	va_list args;
-	va_start(args, count);
-
-	bool* start = &DVD_components_valid_lookup[e * MAXIMUM_COMPONENTS + 0];
-
-	DVD_signature signature{ {}, 0 };
-	memset(signature.field, 0, sizeof(signature.field));
-	for (int i = 0; i < count; i++) {
-		size_t component_id = va_arg(args, size_t);
-		signature.field[component_id] = start[component_id];
-		signature.count = SDL_max(signature.count, component_id + 1);
+	else {
+		visibility_grid.remove(e);
 	}
-
-	va_end(args);
-	return signature;
 }
-DVD_signature DVD_signature_create(size_t count, ...)
-{
-	va_list args;
-	va_start(args, count);
-
-	DVD_signature signature{ {}, 0 };
-	memset(signature.field, 0, sizeof(signature.field));
-	for (int i = 0; i < count; i++) {
-		DVD_component_id component_id = va_arg(args, size_t);
-		signature.field[component_id] = true;
-		signature.count = SDL_max(signature.count, component_id + 1);
-	}
 
-	va_end(args);
-	return signature;
-}
-bool DVD_signature_entity_fulfils(const DVD_entity e, const DVD_signature* signa)
-{
-	bool* entity_signature = &DVD_components_valid_lookup[e * MAXIMUM_COMPONENTS + 0];
-	for (int i = 0; i < signa->count; i++) {
-		bool is_relevant = signa->field[i];
-		if (is_relevant && entity_signature[i] != is_relevant) {
-			return false;
-		}
-	}
-	return true;
-}
-DVD_filter DVD_entities_filter(const DVD_signature* signature)
+DVD_filter visibility_query()
 {
-	DVD_filter f { { INVALID_ENTITY }, 0 };
-	for (int i = 0; i < DVD_entities_used_pivot; i++) {
-		DVD_entity e = DVD_entities_used[i];
-		for (int j = 0; j < signature->count; j++) {
-			if (DVD_signature_entity_fulfils(e, signature)) {
-				f.list[f.count] = e;
-				f.count += 1;
-			}
-		}
-	}
-	return f;
-}
-DVD_filter DVD_entities_filter_ex(const DVD_signature* signa, const DVD_signature* can_not_have)
-{
-	DVD_filter f{ { INVALID_ENTITY }, 0 };
-	for (int i = 0; i < DVD_entities_used_pivot; i++) {
-		DVD_entity e = DVD_entities_used[i];
-		if (DVD_signature_entity_fulfils(e, signa) && !DVD_signature_entity_fulfils(e, can_not_have)) {
-			f.list[f.count] = e;
-			f.count += 1;
-		}
+	// Entities are ids already, the grid writes straight into the frame arena
+	DVD_filter f{ arena::frame().allocate_array<DVD_entity>(visibility_grid.get_count()), 0 };
+	if (f.list == nullptr) {
+		return f;
 	}
+	f.count = visibility_grid.query(engine::get_camera().get_view(), f.list);
 	return f;
 }
-bool DVD_signature_is_identical(const DVD_signature* lhs, const DVD_signature* rhs)
-{
-	size_t max;
-	size_t min;
-	const DVD_signature* check;
-
-	if (lhs->count > rhs->count) {
-		check = lhs;
-		min = rhs->count;
-		max = lhs->count;
-	}
-	else {
-		check = rhs;
-		min = lhs->count;
-		max = rhs->count;
-	}
 
-	for (size_t i = min; i < max; i++) {
-		if (check->field[i]) {
-			return false;
-		}
-	}
-	for (size_t i = 0; i < min; i++) {
-		if (lhs->field[i] != rhs->field[i]) {
-			return false;
-		}
-	}
-	return true;
-}
-DVD_entity DVD_entities_create()
-{
-	if (DVD_entities_available_pivot == 0) {
-		return INVALID_ENTITY;
-	}
-	DVD_entities_available_pivot -= 1;
-	DVD_entity e = DVD_entities_available[DVD_entities_available_pivot];
-	DVD_entities_available[DVD_entities_available_pivot] = INVALID_ENTITY;
-	DVD_entities_used[DVD_entities_used_pivot] = e;
-	DVD_entities_used_pivot += 1;
-	DVD_entity_used_lookup[e] = true;
-	return e;
-}
-DVD_entity DVD_entities_create_copy(DVD_entity of)
-{
-	DVD_entity e = DVD_entities_create();
-	DVD_components_entities_deep_copy(of, e);
-	return e;
-}
-void DVD_entities_invalidate_components(DVD_entity e)
-{
-	bool* start = &DVD_components_valid_lookup[e * MAXIMUM_COMPONENTS + 0];
-	memset(start, 0, sizeof(bool) * MAXIMUM_COMPONENTS);
-}
-void DVD_entities_destroy(DVD_entity* e)
-{
-	if (DVD_entities_used[DVD_entities_used_pivot - 1] == *e) { // just track one back if we remove last one
-		DVD_entities_invalidate_components(*e); // meh, let's just try this
-		DVD_entity_used_lookup[*e] = false;
-		DVD_entities_available[DVD_entities_available_pivot] = *e;
-		DVD_entities_available_pivot += 1;
-		DVD_entities_used_pivot -= 1;
-		DVD_entities_used[DVD_entities_used_pivot] = INVALID_ENTITY;
-	}
-	else {
-		// otherwise... find...
-		for (size_t i = 0; i < DVD_entities_used_pivot; i++) {
-			DVD_entity target = DVD_entities_used[i];
-			if (target == *e) { // found 
-				// shift over 
-				for (size_t j = i; j < DVD_entities_used_pivot - 1; j++) {
-					DVD_entities_used[j] = DVD_entities_used[j + 1];
-				}
-				// How to invalidate all the commponents? :( Entity signature? Maybe? No. FUCK!
-				DVD_entities_invalidate_components(*e); // meh, let's just try this
-				DVD_entity_used_lookup[*e] = false;
-				DVD_entities_available[DVD_entities_available_pivot] = *e;
-				DVD_entities_available_pivot += 1;
-				DVD_entities_used_pivot -= 1;
-				DVD_entities_used[DVD_entities_used_pivot] = INVALID_ENTITY;
-				break;
-			}
-		}
-	}
-}
-void DVD_entities_clear()
+// Every scene calls this after creating its entities, the static ones are put in the grid here and never looked at again,
+// the ones that move are updated once everything moved, destroying an entity has to take it out of the grid
+void visibility_register()
 {
-	for (int i = DVD_entities_used_pivot - 1; i >= 0; i--) {
-		DVD_entities_destroy(&DVD_entities_used[i]);
+	for (size_t i = 0; i < DVD_entities_used_pivot; i++) {
+		visibility_update_system(DVD_entities_used[i]);
 	}
+	DVD_systems_add_in_phase(DVD_PHASE_SYNC, DVD_signature_create(1, gameplay_moves_id), visibility_update_system);
+	DVD_systems_set_render_visibility(visibility_query);
 }
 
-typedef void(*DVD_systems_function)(DVD_entity);
-size_t DVD_systems_internal_update_buffer_pivot{ 0 };
-DVD_signature DVD_systems_internal_update_signatures[MAXIMUM_UPDATE_SYSTEMS];
-DVD_systems_function DVD_systems_internal_update_buffer[MAXIMUM_UPDATE_SYSTEMS];
+// Blocks only keep their collider, what they look like lives in the tilemap, its tiles in the scene arena
+tilemap level_tiles;
 
-size_t DVD_systems_internal_render_buffer_pivot{ 0 };
-DVD_signature DVD_systems_internal_render_signatures[MAXIMUM_RENDER_SYSTEMS];
-DVD_systems_function DVD_systems_internal_render_buffer[MAXIMUM_RENDER_SYSTEMS];
+// Scenes only switch between frames, systems might still be iterating when a button asks for one
+typedef void(*scene_loader)();
+scene_loader pending_scene{ nullptr };
 
-bool DVD_systems_add_on_update(DVD_signature signature, DVD_systems_function func)
-{
-	if (DVD_systems_internal_update_buffer_pivot >= MAXIMUM_UPDATE_SYSTEMS) {
-		return false;
-	}
-	DVD_systems_internal_update_buffer[DVD_systems_internal_update_buffer_pivot] = func;
-	memcpy(&DVD_systems_internal_update_signatures[DVD_systems_internal_update_buffer_pivot], &signature, sizeof(signature));
-	DVD_systems_internal_update_buffer_pivot += 1;
-	return true;
-}
-bool DVD_systems_add_on_render(DVD_signature signature, DVD_systems_function func)
-{
-	if (DVD_systems_internal_render_buffer_pivot >= MAXIMUM_RENDER_SYSTEMS) {
-		return false;
-	}
-	memcpy(&DVD_systems_internal_render_signatures[DVD_systems_internal_render_buffer_pivot], &signature, sizeof(signature));
-	DVD_systems_internal_render_buffer[DVD_systems_internal_render_buffer_pivot] = func;
-	DVD_systems_internal_render_buffer_pivot += 1;
-	return true;
-}
-bool DVD_systems_internal_remove_and_shift_buffer(DVD_systems_function* buffer, size_t* pivot, DVD_systems_function compare)
+void scene_request(scene_loader loader)
 {
-	if (buffer[*pivot - 1] == compare) {
-		// No need to actually do this, but it keeps the memory clean and dandy
-		buffer[*pivot - 1] = nullptr;
-		*pivot -= 1;
-		return true;
-	}
-	else {
-		for (size_t i = 0; i < *pivot - 1; i++) {
-			DVD_systems_function target = buffer[i];
-			if (target == compare) { // found 
-				// shift over 
-				for (size_t j = i; j < *pivot - 1; j++) {
-					buffer[j] = buffer[j + 1];
-				}
-				*pivot -= 1;
-				buffer[*pivot] = nullptr;
-				return true;
-			}
-		}
-	}
-	return false;
+	pending_scene = loader;
 }
-void DVD_systems_remove_all_update()
-{
-	DVD_systems_internal_update_buffer_pivot = 0;
-}
-void DVD_systems_remove_all_render()
-{
-	DVD_systems_internal_render_buffer_pivot = 0;
-}
-void DVD_systems_remove_all()
-{
-	DVD_systems_remove_all_update();
-	DVD_systems_remove_all_render();
-}
-bool DVD_systems_remove_on_update(DVD_systems_function func)
-{
-	return DVD_systems_internal_remove_and_shift_buffer(DVD_systems_internal_update_buffer, &DVD_systems_internal_update_buffer_pivot, func);
-}
-bool DVD_systems_remove_on_render(DVD_systems_function func)
-{
-	return DVD_systems_internal_remove_and_shift_buffer(DVD_systems_internal_render_buffer, &DVD_systems_internal_render_buffer_pivot, func);
-}
-void DVD_systems_run()
-{
-	for (size_t i = 0; i < DVD_systems_internal_update_buffer_pivot; i++) {
-		for (int j = 0; j < DVD_entities_used_pivot; j++) {
-			const DVD_entity e = DVD_entities_used[j];
-			if (DVD_signature_entity_fulfils(e, &DVD_systems_internal_update_signatures[i])) {
-				DVD_systems_internal_update_buffer[i](e);
-			}
-		}
-	}
 
-	engine::render_clear();
-	for (size_t i = 0; i < DVD_systems_internal_render_buffer_pivot; i++) {
-		for (int j = 0; j < DVD_entities_used_pivot; j++) {
-			const DVD_entity e = DVD_entities_used[j];
-			if (DVD_signature_entity_fulfils(e, &DVD_systems_internal_render_signatures[i])) {
-				DVD_systems_internal_render_buffer[i](e);
-			}
-		}
+void scene_apply_pending()
+{
+	if (pending_scene == nullptr) {
+		return;
 	}
+	scene_loader loader = pending_scene;
+	pending_scene = nullptr;
 
-	engine::render_present();
+	DVD_systems_remove_all();
+	DVD_entities_clear();
+	visibility_grid.clear();
+	// Everything the last scene put in the scene arena has to let go of it first
+	level_tiles.destroy();
+	arena::scene().reset();
+	loader();
 }
 
 // User-defined systems!
@@ -484,23 +206,29 @@ void draw_system_each(DVD_entity e)
 	SDL_FRect destination{ p.x, p.y, s.x, s.y };
 	switch (*gameplay_sprite_type_get(e)) {
 		case SPRITE_TYPE_ENTITY:
+			engine::set_draw_layer(DRAW_LAYER_ENTITIES);
 			engine::draw_entity(*gameplay_sprite_index_get(e), destination);
 			break;
 
 		case SPRITE_TYPE_TILE:
+			engine::set_draw_layer(DRAW_LAYER_TILES);
 			engine::draw_tile(*gameplay_sprite_index_get(e), destination);
 			break;
 	}
 }
 
+void tilemap_draw_system(DVD_entity e)
+{
+	engine::set_draw_layer(DRAW_LAYER_TILES);
+	engine::draw_tilemap(**gameplay_tiles_get(e));
+}
+
 void player_system(DVD_entity e)
 {
 	int move{ 0 };
 	controller* c{ gameplay_controller_get(e) };
 
 	if (input::was_pressed(SDL_SCANCODE_BACKSPACE)) {
-		DVD_systems_remove_all();
-		DVD_entities_clear();
 		(*gameplay_button_event_get(e))();
 	}
 
@@ -564,6 +292,11 @@ void ball_collision_system(DVD_entity e)
 
 			SDL_FPoint* direction = gameplay_direction_get(e);
 			(*direction) = SDL_FPointReflect(*direction, normal);
+			if (gameplay_tile_cell_exists(other)) {
+				SDL_Point cell = *gameplay_tile_cell_get(other);
+				level_tiles.set(cell.x, cell.y, { -1, -1 });
+			}
+			visibility_grid.remove(other);
 			DVD_entities_destroy(&other);
 			break;
 		}
@@ -622,9 +355,6 @@ void paddle_ball_collision_system(DVD_entity e)
 					float centreY = (other_collider.y + other_collider.h * 0.5f);
 					centreY += *gameplay_paddle_downset_manipulator_get(e);
 					(*direction) = { ball_collider->x - centreX, ball_collider->y - centreY};
-
-					ball_system(e);
-					collider_update_position_system(e);
 					break;
 				}
 			}
@@ -636,10 +366,10 @@ void debug_rect_collider_system(DVD_entity e)
 {
 	SDL_FRect rect = *gameplay_rect_collider_get(e);
 	if (gameplay_debug_color_exists(e)) {
-		engine::draw_rect(rect, *gameplay_debug_color_get(e));
+		DVD_DEBUG_RECT(rect, *gameplay_debug_color_get(e));
 	}
 	else {
-		engine::draw_rect(rect, { 255, 0, 0, 255 });
+		DVD_DEBUG_RECT(rect, SDL_Colour{ 255, 0, 0, 255 });
 	}
 }
 
@@ -648,7 +378,7 @@ void debug_circle_collider_system(DVD_entity e)
 	
 
 	SDL_FCircle circle = *gameplay_circle_collider_get(e);
-	engine::draw_circle(circle, { 255, 255, 0, 255 });
+	DVD_DEBUG_CIRCLE(circle, SDL_Colour{ 255, 255, 0, 255 });
 }
 
 void debug_capsule_collider_system(DVD_entity e)
@@ -656,7 +386,7 @@ void debug_capsule_collider_system(DVD_entity e)
 	
 
 	SDL_FHorizontalCapsule capsule = *gameplay_capsule_collider_get(e);
-	engine::draw_capsule(capsule, { 255, 255, 0, 255 });
+	DVD_DEBUG_CAPSULE(capsule, SDL_Colour{ 255, 255, 0, 255 });
 }
 
 
@@ -710,12 +440,8 @@ void debug_draw_normals_system(DVD_entity e)
 		SDL_FPoint normal;
 		if (SDL_IntersectFCircleFRect(circle_collider, rect, normal)) { // This is rubbish...
 			SDL_FPoint start = { rect.x + rect.w * 0.5f, rect.y + rect.h * 0.5f};
-			engine::draw_line
-			(
-				start,
-				{ start.x + normal.x * 48.0f, start.y + normal.y * 48.0f },
-				{ 255, 255, 0, 255 }
-			);
+			SDL_FPoint end{ start.x + normal.x * 48.0f, start.y + normal.y * 48.0f };
+			DVD_DEBUG_LINE(start, end, SDL_Colour{ 255, 255, 0, 255 });
 		}
 	}
 }
@@ -739,6 +465,7 @@ void buttom_draw_system(DVD_entity e)
 		colour = *gameplay_hover_colour_get(e);
 	}
 
+	engine::set_draw_layer(DRAW_LAYER_UI);
 	engine::draw_rect(rect, colour);
 	rect.x += padding.x - padding.w * 0.5f;
 	rect.y += padding.y - padding.h * 0.5f;
@@ -757,15 +484,16 @@ void load_gameplay()
 	float block_height = 32.0f;
 	float block_width = 64.0f;
 	SDL_FPoint offset{ 80, 20 };
+	level_tiles.create(10, 5, { block_width, block_height }, offset, arena::scene());
+	DVD_entity level{ DVD_entities_create() };
+	gameplay_tiles_set(level, &level_tiles);
 	for (int x = 0; x < 10; x++) {
 		for (int y = 0; y < 5; y++) {
 			DVD_entity block = DVD_entities_create();
 			SDL_FPoint position{ offset.x + (x * block_width), offset.y + (y * block_height) };
 			SDL_FRect collider{ position.x, position.y, block_width, block_height };
-			gameplay_position_set(block, position);
-			gameplay_size_set(block, { block_width, block_height });
-			gameplay_sprite_index_set(block, { 1, 1 });
-			gameplay_sprite_type_set(block, SPRITE_TYPE_TILE);
+			level_tiles.set(x, y, { 1, 1 });
+			gameplay_tile_cell_set(block, { x, y });
 			gameplay_rect_collider_set(block, collider);
 			gameplay_debug_color_set(block, { 255, 0, 0, 255 });
 			blocks[(y * 10) + x] = block;
@@ -783,10 +511,9 @@ void load_gameplay()
 	gameplay_collider_offset_set(player, { 0, 0 });
 	gameplay_rect_collider_set(player, { 400 - 32, 500 , 64.0f, 16.0f });
 	gameplay_paddle_downset_manipulator_set(player, 64.0f);
+	gameplay_moves_set(player, true);
 	gameplay_button_event_set(player, []() {
-		DVD_entities_clear();
-		DVD_systems_remove_all();
-		load_menu();
+		scene_request(load_menu);
 	});
 
 	//Construct ball
@@ -799,25 +526,35 @@ void load_gameplay()
 	gameplay_direction_set(ball, { 0.0f, -1.0f });
 	gameplay_collider_offset_set(ball, { 8, 8 });
 	gameplay_circle_collider_set(ball, { 400 - 32, 500, 8.0f });
+	gameplay_moves_set(ball, true);
 
 
 	
 	DVD_signature ball_signature = DVD_signature_create(4, gameplay_position_id, gameplay_speed_id, gameplay_direction_id, gameplay_circle_collider_id);
-	DVD_systems_add_on_update(DVD_signature_create(3, gameplay_controller_id, gameplay_position_id, gameplay_speed_id), player_system);
-	DVD_systems_add_on_update(ball_signature, ball_system);
+	DVD_systems_add_in_phase(DVD_PHASE_INPUT, DVD_signature_create(3, gameplay_controller_id, gameplay_position_id, gameplay_speed_id), player_system);
+	DVD_systems_add_in_phase(DVD_PHASE_INPUT, DVD_signature_create(1, gameplay_mouse_position_id), mouse_position_update_system);
+
+	DVD_systems_add_in_phase(DVD_PHASE_SIMULATE, ball_signature, ball_system);
+	DVD_systems_add_in_phase(DVD_PHASE_SIMULATE, DVD_signature_create(1, gameplay_position_id), collider_update_position_system);
+	// Colliders have to follow the moved positions before anything collides
+	DVD_systems_run_after(collider_update_position_system, ball_system);
 
-	DVD_systems_add_on_update(DVD_signature_create(1, gameplay_position_id), collider_update_position_system);
-	DVD_systems_add_on_update(ball_signature, ball_collision_system);
-	DVD_systems_add_on_update(ball_signature, paddle_ball_collision_system);
+	DVD_systems_add_in_phase(DVD_PHASE_COLLIDE, ball_signature, ball_collision_system);
+	DVD_systems_add_in_phase(DVD_PHASE_COLLIDE, ball_signature, paddle_ball_collision_system);
+	DVD_systems_run_after(paddle_ball_collision_system, ball_collision_system);
 
-	DVD_systems_add_on_update(DVD_signature_create(1, gameplay_mouse_position_id), mouse_position_update_system);
 	//DVD_systems_add_on_update(signature_create(2, mouse_position_id, circle_collider_id), debug_circle_collider_position_each);
 
+	DVD_systems_add_on_render(DVD_signature_create(1, gameplay_tiles_id), tilemap_draw_system);
 	DVD_systems_add_on_render(DVD_signature_create(4, gameplay_sprite_type_id, gameplay_sprite_index_id, gameplay_position_id, gameplay_size_id), draw_system_each);
+	visibility_register();
+
+#ifdef DVD_DEBUG_DRAW
 	DVD_systems_add_on_render(DVD_signature_create(1, gameplay_rect_collider_id), debug_rect_collider_system);
 	DVD_systems_add_on_render(DVD_signature_create(1, gameplay_circle_collider_id), debug_circle_collider_system);
 	DVD_systems_add_on_render(DVD_signature_create(1, gameplay_capsule_collider_id), debug_capsule_collider_system);
 	DVD_systems_add_on_render(DVD_signature_create(1, gameplay_rect_collider_id), debug_draw_normals_system);
+#endif
 }
 
 void load_menu()
@@ -829,9 +566,7 @@ void load_menu()
 	gameplay_hover_colour_set(start_button, { 255, 255, 0, 255 });
 	gameplay_unhover_colour_set(start_button, { 255, 0, 255, 255 });
 	gameplay_button_event_set(start_button, []() {
-		DVD_systems_remove_all();
-		DVD_entities_clear();
-		load_gameplay();
+		scene_request(load_gameplay);
 	});
 
 	DVD_entity create_level_button{ DVD_entities_create_copy(start_button) };
@@ -856,6 +591,7 @@ void load_menu()
 	});
 
 	DVD_systems_add_on_render(DVD_signature_create_from_entity(start_button), buttom_draw_system);
+	visibility_register();
 }
 
 // Everything below meant for porting all this stuff on top to C++ : ) 
@@ -1155,22 +891,48 @@ int main()
 
 	DVD_entities_initialise();
 	engine::initialise(SCREEN_WIDTH, SCREEN_HEIGHT);
+	// Nothing here needs more frames than the display shows, the menu sat at a full core without it
+	engine::set_frame_pacing(FRAME_PACING_VSYNC);
+	engine::set_dirty_rendering(true);
+	// Built with tools/asset_packer, without it everything comes from the loose files
+	engine::open_asset_pack("res/assets.pack");
+#ifndef NDEBUG
+	// Saving a sheet in an image editor shows up in the running game
+	engine::set_hot_reload(true);
+#endif
+	visibility_grid.create(128.0f);
 	engine::load_entities_texture("res/objects.png");
 	engine::set_entity_source_size(32, 32);
 
 	engine::load_tiles_texture("res/rock_packed.png");
 	engine::set_tile_source_size(18, 18);
 
-	engine::load_font("res/roboto.ttf");
+	engine::load_font("res/roboto.ttf", "res/roboto.sdf");
 	load_menu();
 
 	bool running = true;
 	events::add(SDL_QUIT, [&running](const SDL_Event&) { running = false; });
+	// Render targets lose their contents when the device resets, the chunks have to be baked again
+	events::add(SDL_RENDER_TARGETS_RESET, [](const SDL_Event&) { level_tiles.invalidate(); engine::invalidate_frame(); });
+	events::add(SDL_WINDOWEVENT, [](const SDL_Event& e) {
+		if (e.window.event == SDL_WINDOWEVENT_EXPOSED) {
+			engine::invalidate_frame();
+		}
+	});
 	events::add(SDL_KEYDOWN, 
 	[&running](const SDL_Event& e)
 	{
 		if (e.key.keysym.scancode == SDL_SCANCODE_ESCAPE) running = false;
+		if (e.key.keysym.scancode == SDL_SCANCODE_F8) frame_pacer::print();
+	});
+#ifdef DVD_PROFILING
+	events::add(SDL_KEYDOWN,
+	[](const SDL_Event& e)
+	{
+		if (e.key.keysym.scancode == SDL_SCANCODE_F9) profiler::print();
+		if (e.key.keysym.scancode == SDL_SCANCODE_F10) profiler::dump_chrome_trace("profile_trace.json");
 	});
+#endif
 
 	Uint64 prev_ticks = SDL_GetPerformanceCounter();
 	while (running) // Each frame
@@ -1184,5 +946,8 @@ int main()
 		input::run();
 
 		DVD_systems_run();
+		arena::frame().reset();
+		scene_apply_pending();
 	}
+	engine::shutdown();
 }
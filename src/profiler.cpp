@@ -0,0 +1,184 @@
+#include "profiler.h"
+
+#ifdef DVD_PROFILING
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+#define MAXIMUM_PROFILED_SYSTEMS 128
+#define MAXIMUM_TRACE_EVENTS 16384
+
+struct profiler_slot
+{
+	const void* id;
+	const char* name;
+	const char* category;
+	size_t head;
+	size_t samples;
+	double milliseconds[profiler::window];
+	size_t visited[profiler::window];
+	size_t matched[profiler::window];
+	size_t calls[profiler::window];
+};
+
+struct profiler_trace_event
+{
+	const char* name;
+	const char* category;
+	unsigned long long start;
+	unsigned long long duration;
+	size_t visited;
+	size_t matched;
+	size_t calls;
+};
+
+static profiler_slot slots[MAXIMUM_PROFILED_SYSTEMS];
+static size_t slots_pivot{ 0 };
+
+// Ring buffer, oldest events get overwritten once it is full
+static profiler_trace_event trace[MAXIMUM_TRACE_EVENTS];
+static size_t trace_head{ 0 };
+static size_t trace_count{ 0 };
+
+static unsigned long long epoch{ profiler::now() };
+static unsigned long long frame_start{ 0 };
+
+static void push_trace_event(const profiler_trace_event& event)
+{
+	trace[trace_head] = event;
+	trace_head = (trace_head + 1) % MAXIMUM_TRACE_EVENTS;
+	if (trace_count < MAXIMUM_TRACE_EVENTS) {
+		trace_count += 1;
+	}
+}
+
+static profiler_slot* find_or_create_slot(const void* id, const char* name, const char* category)
+{
+	for (size_t i = 0; i < slots_pivot; i++) {
+		if (slots[i].id == id && strcmp(slots[i].category, category) == 0) {
+			return &slots[i];
+		}
+	}
+	if (slots_pivot >= MAXIMUM_PROFILED_SYSTEMS) {
+		return nullptr;
+	}
+	profiler_slot* slot = &slots[slots_pivot];
+	memset(slot, 0, sizeof(profiler_slot));
+	slot->id = id;
+	slot->name = name;
+	slot->category = category;
+	slots_pivot += 1;
+	return slot;
+}
+
+unsigned long long profiler::now()
+{
+	using namespace std::chrono;
+	return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void profiler::begin_frame()
+{
+	frame_start = now();
+}
+
+void profiler::end_frame()
+{
+	push_trace_event({ "frame", "frame", frame_start, now() - frame_start, 0, 0, 0 });
+}
+
+void profiler::record(const void* id, const char* name, const char* category, const sample& s)
+{
+	unsigned long long end = now();
+	push_trace_event({ name, category, s.start, end - s.start, s.visited, s.matched, s.calls });
+
+	profiler_slot* slot = find_or_create_slot(id, name, category);
+	if (slot == nullptr) {
+		return;
+	}
+	slot->name = name;
+	slot->milliseconds[slot->head] = (end - s.start) / 1000000.0;
+	slot->visited[slot->head] = s.visited;
+	slot->matched[slot->head] = s.matched;
+	slot->calls[slot->head] = s.calls;
+	slot->head = (slot->head + 1) % window;
+	if (slot->samples < window) {
+		slot->samples += 1;
+	}
+}
+
+size_t profiler::count()
+{
+	return slots_pivot;
+}
+
+bool profiler::get(size_t index, stats& out)
+{
+	if (index >= slots_pivot) {
+		return false;
+	}
+	const profiler_slot& slot = slots[index];
+	out = { slot.name, slot.category, slot.samples, 0.0, 0.0, 0.0, 0.0, 0.0 };
+	if (slot.samples == 0) {
+		return true;
+	}
+	for (size_t i = 0; i < slot.samples; i++) {
+		out.average_ms += slot.milliseconds[i];
+		out.max_ms = slot.milliseconds[i] > out.max_ms ? slot.milliseconds[i] : out.max_ms;
+		out.average_visited += slot.visited[i];
+		out.average_matched += slot.matched[i];
+		out.average_calls += slot.calls[i];
+	}
+	out.average_ms /= slot.samples;
+	out.average_visited /= slot.samples;
+	out.average_matched /= slot.samples;
+	out.average_calls /= slot.samples;
+	return true;
+}
+
+bool profiler::find(const void* id, const char* category, stats& out)
+{
+	for (size_t i = 0; i < slots_pivot; i++) {
+		if (slots[i].id == id && strcmp(slots[i].category, category) == 0) {
+			return get(i, out);
+		}
+	}
+	return false;
+}
+
+void profiler::print()
+{
+	printf("%-40s %-8s %10s %10s %10s %10s %10s\n", "system", "phase", "avg ms", "max ms", "visited", "matched", "calls");
+	for (size_t i = 0; i < slots_pivot; i++) {
+		stats s;
+		get(i, s);
+		printf("%-40s %-8s %10.4f %10.4f %10.1f %10.1f %10.1f\n",
+			s.name, s.category, s.average_ms, s.max_ms, s.average_visited, s.average_matched, s.average_calls);
+	}
+}
+
+bool profiler::dump_chrome_trace(const char* path)
+{
+	FILE* file = fopen(path, "w");
+	if (file == nullptr) {
+		return false;
+	}
+
+	fprintf(file, "{\"traceEvents\":[\n");
+	size_t first = (trace_head + MAXIMUM_TRACE_EVENTS - trace_count) % MAXIMUM_TRACE_EVENTS;
+	for (size_t i = 0; i < trace_count; i++) {
+		const profiler_trace_event& event = trace[(first + i) % MAXIMUM_TRACE_EVENTS];
+		// Timestamps are in microseconds for chrome
+		fprintf(file,
+			"{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f,"
+			"\"args\":{\"visited\":%zu,\"matched\":%zu,\"calls\":%zu}}%s\n",
+			event.name, event.category,
+			(event.start - epoch) / 1000.0, event.duration / 1000.0,
+			event.visited, event.matched, event.calls,
+			i + 1 < trace_count ? "," : "");
+	}
+	fprintf(file, "],\"displayTimeUnit\":\"ms\"}\n");
+	fclose(file);
+	return true;
+}
+#endif
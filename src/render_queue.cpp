@@ -0,0 +1,244 @@
+#include "render_queue.h"
+#include "software_blit.h"
+
+#include <stdio.h>
+#include <SDL/SDL.h>
+
+#define RENDER_KEY_INDEX_BITS 20
+#define RENDER_KEY_DEPTH_BITS 16
+#define RENDER_KEY_BLEND_BITS 4
+#define RENDER_KEY_TEXTURE_BITS 16
+
+#define RENDER_KEY_DEPTH_SHIFT RENDER_KEY_INDEX_BITS
+#define RENDER_KEY_BLEND_SHIFT (RENDER_KEY_DEPTH_SHIFT + RENDER_KEY_DEPTH_BITS)
+#define RENDER_KEY_TEXTURE_SHIFT (RENDER_KEY_BLEND_SHIFT + RENDER_KEY_BLEND_BITS)
+#define RENDER_KEY_LAYER_SHIFT (RENDER_KEY_TEXTURE_SHIFT + RENDER_KEY_TEXTURE_BITS)
+
+#define RENDER_KEY_MASK(bits) ((1ull << (bits)) - 1)
+
+static SDL_BlendMode to_sdl_blend(int blend)
+{
+	switch (blend) {
+	case RENDER_BLEND_ADD: return SDL_BLENDMODE_ADD;
+	case RENDER_BLEND_MOD: return SDL_BLENDMODE_MOD;
+	case RENDER_BLEND_NONE: return SDL_BLENDMODE_NONE;
+	default: return SDL_BLENDMODE_BLEND;
+	}
+}
+
+render_key render_queue::make_key(int layer, int texture_id, render_blend blend, int depth, size_t index)
+{
+	return ((render_key)SDL_clamp(layer, 0, max_layer) << RENDER_KEY_LAYER_SHIFT)
+		| (((render_key)texture_id & RENDER_KEY_MASK(RENDER_KEY_TEXTURE_BITS)) << RENDER_KEY_TEXTURE_SHIFT)
+		| (((render_key)blend & RENDER_KEY_MASK(RENDER_KEY_BLEND_BITS)) << RENDER_KEY_BLEND_SHIFT)
+		| ((render_key)SDL_clamp(depth, 0, max_depth) << RENDER_KEY_DEPTH_SHIFT)
+		| ((render_key)index & RENDER_KEY_MASK(RENDER_KEY_INDEX_BITS));
+}
+
+int render_queue::get_texture_id(SDL_Texture* texture)
+{
+	// Sprites come in runs of the same texture, most lookups stop at the first check
+	if (last_texture < texture_ids.size() && texture_ids[last_texture].first == texture) {
+		return texture_ids[last_texture].second;
+	}
+	for (size_t i = 0; i < texture_ids.size(); i++) {
+		if (texture_ids[i].first == texture) {
+			last_texture = i;
+			return texture_ids[i].second;
+		}
+	}
+	// Past the last id textures share it, they still draw right, they just stop being grouped
+	int id = (int)SDL_min(texture_ids.size() + 1, RENDER_KEY_MASK(RENDER_KEY_TEXTURE_BITS));
+	last_texture = texture_ids.size();
+	texture_ids.push_back({ texture, id });
+	return id;
+}
+
+void render_queue::push(render_key key, const render_command& command)
+{
+	if (commands.size() >= max_commands) {
+		if (!reported_full) {
+			printf("Render queue is full, dropping commands\n");
+			reported_full = true;
+		}
+		return;
+	}
+	keys.push_back(key | commands.size());
+	commands.push_back(command);
+}
+
+void render_queue::push_sprite(int layer, int depth, SDL_Texture* texture, const SDL_Rect& src, const SDL_FRect& dst, SDL_Colour colour, render_blend blend)
+{
+	if (texture == nullptr) {
+		return;
+	}
+	push(make_key(layer, get_texture_id(texture), blend, depth, 0), { RENDER_SPRITE, texture, src, dst, colour });
+}
+
+void render_queue::push_shape(int layer, int depth, render_command_type type, const SDL_FRect& data, SDL_Colour colour, render_blend blend)
+{
+	push(make_key(layer, 0, blend, depth, 0), { type, nullptr, { 0, 0, 0, 0 }, data, colour });
+}
+
+// LSD radix sort, a byte per pass, passes where every key has the same byte are skipped
+// so a frame that only uses a couple of layers and textures gets away with a few passes
+void render_queue::sort()
+{
+	scratch.resize(keys.size());
+	render_key* from = keys.data();
+	render_key* to = scratch.data();
+	for (int shift = 0; shift < 64; shift += 8) {
+		size_t counts[256]{};
+		for (size_t i = 0; i < keys.size(); i++) {
+			counts[(from[i] >> shift) & 0xff] += 1;
+		}
+		if (counts[(from[0] >> shift) & 0xff] == keys.size()) {
+			continue;
+		}
+		size_t offset = 0;
+		for (size_t& count : counts) {
+			size_t c = count;
+			count = offset;
+			offset += c;
+		}
+		for (size_t i = 0; i < keys.size(); i++) {
+			to[counts[(from[i] >> shift) & 0xff]++] = from[i];
+		}
+		render_key* swap = from;
+		from = to;
+		to = swap;
+	}
+	if (from != keys.data()) {
+		keys.swap(scratch);
+	}
+}
+
+void render_queue::flush_batches(SDL_Renderer* renderer)
+{
+	sprites.flush(renderer);
+	shapes.flush(renderer);
+}
+
+static blit_filter get_filter(SDL_Texture* texture)
+{
+	SDL_ScaleMode mode = SDL_ScaleModeNearest;
+	SDL_GetTextureScaleMode(texture, &mode);
+	return mode == SDL_ScaleModeNearest ? BLIT_FILTER_NEAREST : BLIT_FILTER_BILINEAR;
+}
+
+void render_queue::draw(SDL_Renderer* renderer, SDL_Surface* framebuffer, const SDL_Rect* clip)
+{
+	// A batch only breaks when the texture or blend mode changes, which the sort keeps to a minimum
+	SDL_Texture* current_texture = nullptr;
+	int current_blend = -1;
+	SDL_Surface* current_pixels = nullptr;
+	blit_filter current_filter = BLIT_FILTER_NEAREST;
+	for (render_key key : keys) {
+		const render_command& c = commands[key & RENDER_KEY_MASK(RENDER_KEY_INDEX_BITS)];
+		int blend = (int)((key >> RENDER_KEY_BLEND_SHIFT) & RENDER_KEY_MASK(RENDER_KEY_BLEND_BITS));
+		if (c.texture != current_texture || blend != current_blend) {
+			flush_batches(renderer);
+			if (c.texture != nullptr) {
+				SDL_SetTextureBlendMode(c.texture, to_sdl_blend(blend));
+			}
+			else {
+				SDL_SetRenderDrawBlendMode(renderer, to_sdl_blend(blend));
+			}
+			current_texture = c.texture;
+			current_blend = blend;
+			SDL_Surface* pixels = framebuffer != nullptr && c.texture != nullptr ? software_blit::find_pixels(c.texture) : nullptr;
+			if (pixels != nullptr && current_pixels == nullptr) {
+				// The renderer queues its draws, they have to be in the framebuffer before blitting over them
+				SDL_RenderFlush(renderer);
+			}
+			else if (pixels == nullptr) {
+				// And the other way around, the blits have to be done before the renderer draws over them
+				blits.flush(framebuffer, clip);
+			}
+			current_pixels = pixels;
+			if (current_pixels != nullptr) {
+				current_filter = get_filter(c.texture);
+			}
+		}
+
+		const SDL_FRect& d = c.dst;
+		switch (c.type) {
+		case RENDER_SPRITE:
+			if (current_pixels != nullptr) {
+				blits.add(current_pixels, c.src, d, c.colour, to_sdl_blend(blend), current_filter);
+			}
+			else {
+				sprites.add(c.texture, c.src, d, c.colour);
+			}
+			break;
+		case RENDER_RECT:
+			shapes.add_rect(d, c.colour);
+			break;
+		case RENDER_FILL_RECT:
+			shapes.fill_rect(d, c.colour);
+			break;
+		case RENDER_LINE:
+			shapes.add_line({ d.x, d.y }, { d.w, d.h }, c.colour);
+			break;
+		case RENDER_CIRCLE:
+			shapes.add_circle({ d.x, d.y }, d.w, c.colour);
+			break;
+		case RENDER_FILL_CIRCLE:
+			shapes.fill_circle({ d.x, d.y }, d.w, c.colour);
+			break;
+		case RENDER_CAPSULE:
+			shapes.add_capsule({ d.x, d.y }, { d.w, d.h }, c.colour);
+			break;
+		}
+	}
+	flush_batches(renderer);
+	blits.flush(framebuffer, clip);
+}
+
+void render_queue::submit(SDL_Renderer* renderer, SDL_Surface* framebuffer, const SDL_Rect* clips, int clip_count)
+{
+	if (commands.empty()) {
+		return;
+	}
+	sort();
+
+	SDL_BlendMode previous_blend;
+	SDL_GetRenderDrawBlendMode(renderer, &previous_blend);
+	if (clip_count <= 0) {
+		draw(renderer, framebuffer, nullptr);
+	}
+	else {
+		// Everything is walked once per clip, cheap next to the pixels it saves
+		for (int i = 0; i < clip_count; i++) {
+			SDL_RenderSetClipRect(renderer, &clips[i]);
+			draw(renderer, framebuffer, &clips[i]);
+		}
+		SDL_RenderSetClipRect(renderer, nullptr);
+	}
+	SDL_SetRenderDrawBlendMode(renderer, previous_blend);
+	clear();
+}
+
+void render_queue::clear()
+{
+	commands.clear();
+	keys.clear();
+	texture_ids.clear();
+	last_texture = 0;
+	reported_full = false;
+}
+
+size_t render_queue::size() const
+{
+	return commands.size();
+}
+
+const render_command& render_queue::get_command(size_t index) const
+{
+	return commands[index];
+}
+
+render_key render_queue::get_key(size_t index) const
+{
+	return keys[index] & ~(RENDER_KEY_MASK(RENDER_KEY_INDEX_BITS) | (RENDER_KEY_MASK(RENDER_KEY_TEXTURE_BITS) << RENDER_KEY_TEXTURE_SHIFT));
+}
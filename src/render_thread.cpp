@@ -0,0 +1,156 @@
+#include "render_thread.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <SDL/SDL.h>
+
+struct pending_call
+{
+	const render_thread::task* work;
+	bool finished;
+};
+
+static SDL_Renderer* renderer{ nullptr };
+static std::thread thread;
+static std::thread::id thread_id;
+static bool running{ false };
+static bool stopping{ false };
+
+static std::mutex mutex;
+// Wakes the render thread up, for calls, frames and stopping
+static std::condition_variable wake;
+// Wakes up whoever waits for a call or a frame to finish
+static std::condition_variable finished;
+static std::vector<pending_call*> calls;
+static render_thread::task frame;
+static bool frame_pending{ false };
+
+static void loop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		wake.wait(lock, []() { return stopping || frame_pending || !calls.empty(); });
+
+		// Calls first, a caller is blocked on them while a frame only has the next frame waiting
+		if (!calls.empty()) {
+			pending_call* c = calls.front();
+			calls.erase(calls.begin());
+			lock.unlock();
+			(*c->work)();
+			lock.lock();
+			c->finished = true;
+			finished.notify_all();
+			continue;
+		}
+		if (frame_pending) {
+			render_thread::task current = std::move(frame);
+			lock.unlock();
+			current();
+			lock.lock();
+			frame_pending = false;
+			finished.notify_all();
+			continue;
+		}
+		if (stopping) {
+			break;
+		}
+	}
+}
+
+// The renderer belongs to the thread that created it, so it is created on the render thread itself
+static SDL_Renderer* launch(bool threaded, const render_thread::task& create)
+{
+	if (threaded) {
+		stopping = false;
+		running = true;
+		thread = std::thread(loop);
+		thread_id = thread.get_id();
+	}
+	render_thread::call(create);
+	if (renderer == nullptr) {
+		printf("Could not create renderer: %s\n", SDL_GetError());
+	}
+	return renderer;
+}
+
+SDL_Renderer* render_thread::start(SDL_Window* window, unsigned int renderer_flags, bool threaded)
+{
+	return launch(threaded, [&]() {
+		renderer = SDL_CreateRenderer(window, -1, renderer_flags);
+	});
+}
+
+SDL_Renderer* render_thread::start(SDL_Surface* framebuffer, bool threaded)
+{
+	return launch(threaded, [&]() {
+		renderer = SDL_CreateSoftwareRenderer(framebuffer);
+	});
+}
+
+void render_thread::stop()
+{
+	wait_idle();
+	call([]() {
+		SDL_DestroyRenderer(renderer);
+		renderer = nullptr;
+	});
+	if (!running) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_one();
+	thread.join();
+	running = false;
+	thread_id = std::thread::id();
+}
+
+bool render_thread::is_running()
+{
+	return running;
+}
+
+bool render_thread::is_render_thread()
+{
+	return !running || std::this_thread::get_id() == thread_id;
+}
+
+void render_thread::call(const task& t)
+{
+	if (is_render_thread()) {
+		t();
+		return;
+	}
+	pending_call c{ &t, false };
+	std::unique_lock<std::mutex> lock(mutex);
+	calls.push_back(&c);
+	wake.notify_one();
+	finished.wait(lock, [&c]() { return c.finished; });
+}
+
+void render_thread::submit_frame(const task& f)
+{
+	if (is_render_thread()) {
+		f();
+		return;
+	}
+	std::unique_lock<std::mutex> lock(mutex);
+	finished.wait(lock, []() { return !frame_pending; });
+	frame = f;
+	frame_pending = true;
+	wake.notify_one();
+}
+
+void render_thread::wait_idle()
+{
+	if (!running) {
+		return;
+	}
+	std::unique_lock<std::mutex> lock(mutex);
+	finished.wait(lock, []() { return !frame_pending; });
+}
@@ -0,0 +1,344 @@
+#include "sdf_font.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <SDL/SDL.h>
+#include <SDL/SDL_ttf.h>
+
+#define SDF_CACHE_MAGIC 0x32464453 // "SDF2"
+
+// Layout: header, the glyphs, the kerning table, then the fields
+// Fixed width and padded by hand, a cache written on one platform reads the same on any other little endian one
+struct sdf_cache_header
+{
+	Uint32 magic;
+	Sint32 character_count;
+	Sint64 source_size;
+	Sint32 base_height;
+	Sint32 spread;
+	Uint64 field_size;
+};
+static_assert(sizeof(sdf_cache_header) == 32, "sdf cache header has padding");
+static_assert(sizeof(sdf_font::glyph) == 24, "sdf cache glyph has padding");
+
+// 8SSEDT, every cell tracks the offset to the closest seed cell and two sweeps spread them out
+struct sdf_offset
+{
+	int dx, dy;
+};
+
+static const sdf_offset far_away{ 9999, 9999 };
+
+static int length_squared(const sdf_offset& o)
+{
+	return o.dx * o.dx + o.dy * o.dy;
+}
+
+static void compare(const std::vector<sdf_offset>& grid, int width, int height, int x, int y, int offset_x, int offset_y, sdf_offset& current)
+{
+	int nx = x + offset_x;
+	int ny = y + offset_y;
+	sdf_offset other = (nx < 0 || ny < 0 || nx >= width || ny >= height) ? far_away : grid[ny * width + nx];
+	other.dx += offset_x;
+	other.dy += offset_y;
+	if (length_squared(other) < length_squared(current)) {
+		current = other;
+	}
+}
+
+static void propagate(std::vector<sdf_offset>& grid, int width, int height)
+{
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			sdf_offset p = grid[y * width + x];
+			compare(grid, width, height, x, y, -1, 0, p);
+			compare(grid, width, height, x, y, 0, -1, p);
+			compare(grid, width, height, x, y, -1, -1, p);
+			compare(grid, width, height, x, y, 1, -1, p);
+			grid[y * width + x] = p;
+		}
+		for (int x = width - 1; x >= 0; x--) {
+			sdf_offset p = grid[y * width + x];
+			compare(grid, width, height, x, y, 1, 0, p);
+			grid[y * width + x] = p;
+		}
+	}
+	for (int y = height - 1; y >= 0; y--) {
+		for (int x = width - 1; x >= 0; x--) {
+			sdf_offset p = grid[y * width + x];
+			compare(grid, width, height, x, y, 1, 0, p);
+			compare(grid, width, height, x, y, 0, 1, p);
+			compare(grid, width, height, x, y, -1, 1, p);
+			compare(grid, width, height, x, y, 1, 1, p);
+			grid[y * width + x] = p;
+		}
+		for (int x = 0; x < width; x++) {
+			sdf_offset p = grid[y * width + x];
+			compare(grid, width, height, x, y, -1, 0, p);
+			grid[y * width + x] = p;
+		}
+	}
+}
+
+static long file_size(const char* path)
+{
+	FILE* file = fopen(path, "rb");
+	if (file == nullptr) {
+		return -1;
+	}
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fclose(file);
+	return size;
+}
+
+bool sdf_font::bake(const char* ttf_path, int base_size, int field_spread)
+{
+	TTF_Font* font = TTF_OpenFont(ttf_path, base_size);
+	if (font == nullptr) {
+		printf("Could not open %s: %s\n", ttf_path, TTF_GetError());
+		return false;
+	}
+	base_height = TTF_FontHeight(font);
+	spread = field_spread;
+	fields.clear();
+
+	kerning.assign(character_count * character_count, 0);
+	if (TTF_GetFontKerning(font)) {
+		for (int a = 0; a < character_count; a++) {
+			for (int b = 0; b < character_count; b++) {
+				kerning[a * character_count + b] = (Sint16)TTF_GetFontKerningSizeGlyphs(font, a + first_character, b + first_character);
+			}
+		}
+	}
+
+	std::vector<sdf_offset> inside;
+	std::vector<sdf_offset> outside;
+	for (int i = 0; i < character_count; i++) {
+		Uint16 character = (Uint16)(i + first_character);
+		glyph& g = glyphs[i];
+		g = { 0, 0, 0, 0, fields.size() };
+
+		int min_x, max_x, min_y, max_y;
+		if (!TTF_GlyphIsProvided(font, character) || TTF_GlyphMetrics(font, character, &min_x, &max_x, &min_y, &max_y, &g.advance) != 0) {
+			continue;
+		}
+		SDL_Surface* rendered = TTF_RenderGlyph_Blended(font, character, { 255, 255, 255, 255 });
+		SDL_Surface* coverage = rendered != nullptr ? SDL_ConvertSurfaceFormat(rendered, SDL_PIXELFORMAT_RGBA32, 0) : nullptr;
+		SDL_FreeSurface(rendered);
+		if (coverage == nullptr) {
+			continue;
+		}
+
+		g.width = coverage->w + spread * 2;
+		g.height = coverage->h + spread * 2;
+		g.offset_x = SDL_min(0, min_x) - spread;
+
+		inside.assign(g.width * g.height, far_away);
+		outside.assign(g.width * g.height, { 0, 0 });
+		for (int y = 0; y < coverage->h; y++) {
+			const Uint8* row = (const Uint8*)coverage->pixels + y * coverage->pitch;
+			for (int x = 0; x < coverage->w; x++) {
+				if (row[x * 4 + 3] >= 128) {
+					size_t index = (y + spread) * g.width + x + spread;
+					inside[index] = { 0, 0 };
+					outside[index] = far_away;
+				}
+			}
+		}
+		SDL_FreeSurface(coverage);
+
+		propagate(inside, g.width, g.height);
+		propagate(outside, g.width, g.height);
+		fields.resize(fields.size() + g.width * g.height);
+		unsigned char* field = fields.data() + g.pixels;
+		for (int p = 0; p < g.width * g.height; p++) {
+			float distance = sqrtf((float)length_squared(outside[p])) - sqrtf((float)length_squared(inside[p]));
+			float value = 0.5f + distance / (2.0f * spread);
+			field[p] = (unsigned char)(SDL_clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+		}
+	}
+
+	TTF_CloseFont(font);
+	return true;
+}
+
+bool sdf_font::load_cache(const char* path, const char* ttf_path)
+{
+	FILE* file = fopen(path, "rb");
+	if (file == nullptr) {
+		return false;
+	}
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	std::vector<unsigned char> cache(size > 0 ? (size_t)size : 0);
+	bool valid = !cache.empty() && fread(cache.data(), 1, cache.size(), file) == cache.size();
+	fclose(file);
+	return valid && read_cache(cache.data(), cache.size(), file_size(ttf_path));
+}
+
+bool sdf_font::save_cache(const char* path, const char* ttf_path) const
+{
+	std::vector<unsigned char> cache;
+	if (!write_cache(cache, file_size(ttf_path))) {
+		return false;
+	}
+	FILE* file = fopen(path, "wb");
+	if (file == nullptr) {
+		return false;
+	}
+	bool written = fwrite(cache.data(), 1, cache.size(), file) == cache.size();
+	fclose(file);
+	return written;
+}
+
+bool sdf_font::validate_cache(const void* data, size_t size, long source_size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	size_t table_size = sizeof(Sint16) * character_count * character_count;
+	size_t glyphs_size = sizeof(glyph) * character_count;
+	sdf_cache_header header;
+	if (size < sizeof(header)) {
+		return false;
+	}
+	memcpy(&header, bytes, sizeof(header));
+	if (header.magic != SDF_CACHE_MAGIC
+		|| header.character_count != character_count
+		|| (source_size >= 0 && header.source_size != source_size)
+		|| header.base_height <= 0
+		|| size - sizeof(header) < glyphs_size + table_size
+		|| size - sizeof(header) - glyphs_size - table_size < header.field_size) {
+		return false;
+	}
+	// resolve trusts the glyphs, every one has to stay inside the fields
+	for (int i = 0; i < character_count; i++) {
+		glyph g;
+		memcpy(&g, bytes + sizeof(header) + i * sizeof(g), sizeof(g));
+		if (g.width < 0 || g.height < 0 || g.pixels > header.field_size
+			|| (Uint64)g.width * (Uint64)g.height > header.field_size - g.pixels) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool sdf_font::read_cache(const void* data, size_t size, long source_size)
+{
+	if (!validate_cache(data, size, source_size)) {
+		// Stale or broken, the caller will bake again
+		fields.clear();
+		kerning.clear();
+		base_height = 0;
+		return false;
+	}
+	const unsigned char* bytes = (const unsigned char*)data;
+	size_t table_size = sizeof(Sint16) * character_count * character_count;
+	sdf_cache_header header;
+	memcpy(&header, bytes, sizeof(header));
+	bytes += sizeof(header);
+	memcpy(glyphs, bytes, sizeof(glyphs));
+	bytes += sizeof(glyphs);
+	kerning.resize(character_count * character_count);
+	memcpy(kerning.data(), bytes, table_size);
+	bytes += table_size;
+	fields.assign(bytes, bytes + header.field_size);
+	base_height = header.base_height;
+	spread = header.spread;
+	return true;
+}
+
+bool sdf_font::write_cache(std::vector<unsigned char>& out_cache, long source_size) const
+{
+	if (!is_baked()) {
+		return false;
+	}
+	sdf_cache_header header{ SDF_CACHE_MAGIC, character_count, source_size, base_height, spread, fields.size() };
+	const unsigned char* kerning_bytes = (const unsigned char*)kerning.data();
+	out_cache.clear();
+	out_cache.insert(out_cache.end(), (const unsigned char*)&header, (const unsigned char*)(&header + 1));
+	out_cache.insert(out_cache.end(), (const unsigned char*)glyphs, (const unsigned char*)glyphs + sizeof(glyphs));
+	out_cache.insert(out_cache.end(), kerning_bytes, kerning_bytes + kerning.size() * sizeof(Sint16));
+	out_cache.insert(out_cache.end(), fields.begin(), fields.end());
+	return true;
+}
+
+bool sdf_font::is_baked() const
+{
+	return base_height > 0;
+}
+
+size_t sdf_font::get_memory() const
+{
+	return fields.size() + kerning.size() * sizeof(Sint16);
+}
+
+const sdf_font::glyph* sdf_font::get(unsigned char character) const
+{
+	if (character < first_character || !is_baked()) {
+		return nullptr;
+	}
+	return &glyphs[character - first_character];
+}
+
+int sdf_font::get_kerning(unsigned char previous, unsigned char character) const
+{
+	if (previous < first_character || character < first_character || kerning.empty()) {
+		return 0;
+	}
+	return kerning[(previous - first_character) * character_count + (character - first_character)];
+}
+
+int sdf_font::get_base_height() const
+{
+	return base_height;
+}
+
+int sdf_font::get_spread() const
+{
+	return spread;
+}
+
+SDL_Surface* sdf_font::resolve(unsigned char character, float pixel_height) const
+{
+	const glyph* g = get(character);
+	if (g == nullptr || g->width == 0 || pixel_height <= 0.0f) {
+		return nullptr;
+	}
+	float scale = pixel_height / base_height;
+	int width = SDL_max(1, (int)ceilf(g->width * scale));
+	int height = SDL_max(1, (int)ceilf(g->height * scale));
+	SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_RGBA32);
+	if (surface == nullptr) {
+		return nullptr;
+	}
+
+	const unsigned char* field = fields.data() + g->pixels;
+	// One output pixel wide anti-aliasing band around the outline
+	float sharpness = 2.0f * spread * scale;
+	for (int y = 0; y < height; y++) {
+		Uint8* row = (Uint8*)surface->pixels + y * surface->pitch;
+		float fy = SDL_clamp((y + 0.5f) / scale - 0.5f, 0.0f, (float)(g->height - 1));
+		int y0 = (int)fy;
+		int y1 = SDL_min(y0 + 1, g->height - 1);
+		float ty = fy - y0;
+		for (int x = 0; x < width; x++) {
+			float fx = SDL_clamp((x + 0.5f) / scale - 0.5f, 0.0f, (float)(g->width - 1));
+			int x0 = (int)fx;
+			int x1 = SDL_min(x0 + 1, g->width - 1);
+			float tx = fx - x0;
+
+			float top = field[y0 * g->width + x0] * (1.0f - tx) + field[y0 * g->width + x1] * tx;
+			float bottom = field[y1 * g->width + x0] * (1.0f - tx) + field[y1 * g->width + x1] * tx;
+			float distance = (top * (1.0f - ty) + bottom * ty) / 255.0f;
+			float alpha = SDL_clamp((distance - 0.5f) * sharpness + 0.5f, 0.0f, 1.0f);
+
+			row[x * 4 + 0] = 255;
+			row[x * 4 + 1] = 255;
+			row[x * 4 + 2] = 255;
+			row[x * 4 + 3] = (Uint8)(alpha * 255.0f + 0.5f);
+		}
+	}
+	return surface;
+}
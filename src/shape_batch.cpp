@@ -0,0 +1,164 @@
+#include "shape_batch.h"
+
+#include <math.h>
+
+// Points around the unit circle, circles of any size step through it with a stride instead of calling cosf/sinf
+#define UNIT_CIRCLE_STEPS 64
+// The most a segment may cut into the real circle, in pixels
+#define CIRCLE_TOLERANCE 0.5f
+
+struct unit_circle
+{
+	SDL_FPoint points[UNIT_CIRCLE_STEPS + 1];
+	// How far a chord sags from the circle per unit of radius, for each stride of 1, 2, 4 and 8
+	float sagitta[4];
+
+	unit_circle()
+	{
+		for (int i = 0; i <= UNIT_CIRCLE_STEPS; i++) {
+			float angle = (2.0f * (float)M_PI * i) / UNIT_CIRCLE_STEPS;
+			points[i] = { cosf(angle), sinf(angle) };
+		}
+		for (int i = 0; i < 4; i++) {
+			int segments = UNIT_CIRCLE_STEPS >> i;
+			sagitta[i] = 1.0f - cosf((float)M_PI / segments);
+		}
+	}
+};
+
+static const unit_circle circle_table;
+
+// Coarsest stride whose segments stay within the tolerance at this on-screen radius
+static int get_stride(float radius)
+{
+	for (int i = 3; i > 0; i--) {
+		if (radius * circle_table.sagitta[i] <= CIRCLE_TOLERANCE) {
+			return 1 << i;
+		}
+	}
+	return 1;
+}
+
+void shape_batch::add_arc(const SDL_FPoint& center, float radius, int first_step, int steps, int stride)
+{
+	for (int i = 0; i <= steps; i += stride) {
+		const SDL_FPoint& p = circle_table.points[(first_step + i) % UNIT_CIRCLE_STEPS];
+		points.push_back({ center.x + p.x * radius, center.y + p.y * radius });
+	}
+}
+
+// A pixel wide quad along the segment, stretched half a pixel past both ends so the corners of outlines close
+// Shifted to the pixel centers, the same pixels SDL_RenderDrawLinesF lit for whole coordinates
+void shape_batch::add_segment(const SDL_FPoint& a, const SDL_FPoint& b, SDL_Colour colour)
+{
+	float dx = b.x - a.x;
+	float dy = b.y - a.y;
+	float length = sqrtf(dx * dx + dy * dy);
+	// A segment without length is still a pixel
+	if (length < 0.0001f) {
+		dx = 1.0f;
+		dy = 0.0f;
+		length = 1.0f;
+	}
+	dx *= 0.5f / length;
+	dy *= 0.5f / length;
+	SDL_FPoint start{ a.x + 0.5f - dx, a.y + 0.5f - dy };
+	SDL_FPoint end{ b.x + 0.5f + dx, b.y + 0.5f + dy };
+
+	int base = (int)vertices.size();
+	vertices.push_back({ { start.x - dy, start.y + dx }, colour, { 0, 0 } });
+	vertices.push_back({ { end.x - dy, end.y + dx }, colour, { 0, 0 } });
+	vertices.push_back({ { end.x + dy, end.y - dx }, colour, { 0, 0 } });
+	vertices.push_back({ { start.x + dy, start.y - dx }, colour, { 0, 0 } });
+	int quad[] = { 0, 1, 2, 2, 3, 0 };
+	for (int i : quad) {
+		indices.push_back(base + i);
+	}
+}
+
+void shape_batch::add_polyline(const SDL_FPoint* polyline, size_t count, SDL_Colour colour)
+{
+	for (size_t i = 1; i < count; i++) {
+		add_segment(polyline[i - 1], polyline[i], colour);
+	}
+}
+
+void shape_batch::add_line(const SDL_FPoint& a, const SDL_FPoint& b, SDL_Colour colour)
+{
+	add_segment(a, b, colour);
+}
+
+void shape_batch::add_rect(const SDL_FRect& rect, SDL_Colour colour)
+{
+	// Same corners SDL_RenderDrawRectF lights, the right and bottom edge sit on the last pixel inside
+	float right = rect.x + SDL_max(rect.w - 1.0f, 0.0f);
+	float bottom = rect.y + SDL_max(rect.h - 1.0f, 0.0f);
+	SDL_FPoint corners[] = { { rect.x, rect.y }, { right, rect.y }, { right, bottom }, { rect.x, bottom }, { rect.x, rect.y } };
+	add_polyline(corners, SDL_arraysize(corners), colour);
+}
+
+void shape_batch::add_circle(const SDL_FPoint& center, float radius, SDL_Colour colour)
+{
+	points.clear();
+	add_arc(center, radius, 0, UNIT_CIRCLE_STEPS, get_stride(radius));
+	add_polyline(points.data(), points.size(), colour);
+}
+
+void shape_batch::add_capsule(const SDL_FPoint& center, const SDL_FPoint& size, SDL_Colour colour)
+{
+	points.clear();
+	int stride = get_stride(size.y);
+	int half = UNIT_CIRCLE_STEPS / 2;
+	// Right cap goes from the top (-90 degrees) down to the bottom, the left cap back up, the closing segments are the straight sides
+	add_arc({ center.x + size.x * 0.5f, center.y }, size.y, half + half / 2, half, stride);
+	add_arc({ center.x - size.x * 0.5f, center.y }, size.y, half / 2, half, stride);
+	points.push_back(points[0]);
+	add_polyline(points.data(), points.size(), colour);
+}
+
+void shape_batch::fill_rect(const SDL_FRect& rect, SDL_Colour colour)
+{
+	int base = (int)vertices.size();
+	vertices.push_back({ { rect.x, rect.y }, colour, { 0, 0 } });
+	vertices.push_back({ { rect.x + rect.w, rect.y }, colour, { 0, 0 } });
+	vertices.push_back({ { rect.x + rect.w, rect.y + rect.h }, colour, { 0, 0 } });
+	vertices.push_back({ { rect.x, rect.y + rect.h }, colour, { 0, 0 } });
+	int quad[] = { 0, 1, 2, 2, 3, 0 };
+	for (int i : quad) {
+		indices.push_back(base + i);
+	}
+}
+
+void shape_batch::fill_circle(const SDL_FPoint& center, float radius, SDL_Colour colour)
+{
+	// Triangle fan around the center vertex
+	int base = (int)vertices.size();
+	int stride = get_stride(radius);
+	vertices.push_back({ center, colour, { 0, 0 } });
+	for (int i = 0; i < UNIT_CIRCLE_STEPS; i += stride) {
+		const SDL_FPoint& p = circle_table.points[i];
+		vertices.push_back({ { center.x + p.x * radius, center.y + p.y * radius }, colour, { 0, 0 } });
+	}
+	int segments = UNIT_CIRCLE_STEPS / stride;
+	for (int i = 0; i < segments; i++) {
+		indices.push_back(base);
+		indices.push_back(base + 1 + i);
+		indices.push_back(base + 1 + (i + 1) % segments);
+	}
+}
+
+void shape_batch::flush(SDL_Renderer* renderer)
+{
+	if (is_empty()) {
+		return;
+	}
+	// Fills and outlines are the same kind of triangles, one call draws them in the order they were added
+	SDL_RenderGeometry(renderer, nullptr, vertices.data(), (int)vertices.size(), indices.data(), (int)indices.size());
+	vertices.clear();
+	indices.clear();
+}
+
+bool shape_batch::is_empty() const
+{
+	return vertices.empty();
+}
@@ -0,0 +1,384 @@
+#include "software_blit.h"
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <SDL/SDL.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define BLIT_X86
+#include <immintrin.h>
+#endif
+
+// MSVC takes AVX2 intrinsics anywhere, gcc and clang only inside functions marked for it
+#if defined(BLIT_X86) && (defined(__GNUC__) || defined(__clang__))
+#define BLIT_AVX2 __attribute__((target("avx2")))
+#else
+#define BLIT_AVX2
+#endif
+
+// Source positions are 16.16 fixed point, whole pixel steps keep the same position for a pixel however the rows get split up
+#define BLIT_ONE (1 << 16)
+#define BLIT_HALF (1 << 15)
+
+typedef void (*blend_row_function)(Uint32* dst, const Uint32* src, int count, const Uint8* colour);
+typedef void (*sample_row_function)(const Uint8* top, const Uint8* bottom, int fy, int width, Sint64 u, Sint64 du, Uint32* out, int count);
+
+static std::mutex pixels_mutex;
+static std::unordered_map<SDL_Texture*, SDL_Surface*> pixels_by_texture;
+
+// Rows are sampled into this before blending, one per thread so tiles can be drawn in parallel
+static thread_local std::vector<Uint32> sampled;
+
+// x / 255 rounded, exact for anything two bytes multiplied can give
+static inline Uint32 div255(Uint32 x)
+{
+	x += 128;
+	return (x + (x >> 8)) >> 8;
+}
+
+// Channels are in memory order, r g b a for RGBA32
+template <int blend>
+static void blend_row_scalar(Uint32* dst, const Uint32* src, int count, const Uint8* colour)
+{
+	for (int i = 0; i < count; i++) {
+		const Uint8* s = (const Uint8*)(src + i);
+		Uint8* d = (Uint8*)(dst + i);
+		Uint32 c[4];
+		for (int k = 0; k < 4; k++) {
+			c[k] = div255(s[k] * colour[k]);
+		}
+		Uint32 a = c[3];
+		switch (blend) {
+		case SDL_BLENDMODE_NONE:
+			for (int k = 0; k < 4; k++) {
+				d[k] = (Uint8)c[k];
+			}
+			break;
+		case SDL_BLENDMODE_ADD:
+			for (int k = 0; k < 3; k++) {
+				d[k] = (Uint8)SDL_min(255u, d[k] + div255(c[k] * a));
+			}
+			break;
+		case SDL_BLENDMODE_MOD:
+			for (int k = 0; k < 3; k++) {
+				d[k] = (Uint8)div255(c[k] * d[k]);
+			}
+			break;
+		default:
+			// Alpha blends like a colour channel whose source is always 255
+			c[3] = 255;
+			for (int k = 0; k < 4; k++) {
+				d[k] = (Uint8)div255(c[k] * a + d[k] * (255 - a));
+			}
+			break;
+		}
+	}
+}
+
+static void sample_nearest(const Uint8* top, const Uint8*, int, int width, Sint64 u, Sint64 du, Uint32* out, int count)
+{
+	const Uint32* row = (const Uint32*)top;
+	for (int i = 0; i < count; i++, u += du) {
+		out[i] = row[SDL_clamp((int)(u >> 16), 0, width - 1)];
+	}
+}
+
+// Weights are 8 bit, vertical first then horizontal, each pass drops the weight bits again
+static void sample_bilinear_scalar(const Uint8* top, const Uint8* bottom, int fy, int width, Sint64 u, Sint64 du, Uint32* out, int count)
+{
+	for (int i = 0; i < count; i++, u += du) {
+		Sint64 left = u - BLIT_HALF;
+		int x = (int)(left >> 16);
+		int fx = (int)((left >> 8) & 0xff);
+		int x0 = SDL_clamp(x, 0, width - 1) * 4;
+		int x1 = SDL_clamp(x + 1, 0, width - 1) * 4;
+		Uint8* o = (Uint8*)(out + i);
+		for (int k = 0; k < 4; k++) {
+			Uint32 l = (top[x0 + k] * (256 - fy) + bottom[x0 + k] * fy) >> 8;
+			Uint32 r = (top[x1 + k] * (256 - fy) + bottom[x1 + k] * fy) >> 8;
+			o[k] = (Uint8)((l * (256 - fx) + r * fx) >> 8);
+		}
+	}
+}
+
+#ifdef BLIT_X86
+// Two pixels per register, a channel per 16 bit lane, alpha in lanes 3 and 7
+static inline __m128i div255_sse2(__m128i x)
+{
+	x = _mm_add_epi16(x, _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+template <int blend>
+static inline __m128i blend_sse2(__m128i d, __m128i s, __m128i colour)
+{
+	s = div255_sse2(_mm_mullo_epi16(s, colour));
+	if (blend == SDL_BLENDMODE_NONE) {
+		return s;
+	}
+	const __m128i alpha_lanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+	__m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	if (blend == SDL_BLENDMODE_ADD || blend == SDL_BLENDMODE_MOD) {
+		__m128i rgb = blend == SDL_BLENDMODE_ADD
+			? _mm_min_epi16(_mm_add_epi16(d, div255_sse2(_mm_mullo_epi16(s, a))), _mm_set1_epi16(255))
+			: div255_sse2(_mm_mullo_epi16(s, d));
+		return _mm_or_si128(_mm_andnot_si128(alpha_lanes, rgb), _mm_and_si128(alpha_lanes, d));
+	}
+	s = _mm_or_si128(s, _mm_and_si128(alpha_lanes, _mm_set1_epi16(255)));
+	__m128i inverse = _mm_sub_epi16(_mm_set1_epi16(255), a);
+	return div255_sse2(_mm_add_epi16(_mm_mullo_epi16(s, a), _mm_mullo_epi16(d, inverse)));
+}
+
+template <int blend>
+static void blend_row_sse2(Uint32* dst, const Uint32* src, int count, const Uint8* colour)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i c = _mm_set_epi16(colour[3], colour[2], colour[1], colour[0], colour[3], colour[2], colour[1], colour[0]);
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+		__m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+		__m128i lo = blend_sse2<blend>(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero), c);
+		__m128i hi = blend_sse2<blend>(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero), c);
+		_mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(lo, hi));
+	}
+	blend_row_scalar<blend>(dst + i, src + i, count - i, colour);
+}
+
+// Same maths as the scalar version, the two neighbouring columns share a register
+static void sample_bilinear_sse2(const Uint8* top, const Uint8* bottom, int fy, int width, Sint64 u, Sint64 du, Uint32* out, int count)
+{
+	const Uint32* top_row = (const Uint32*)top;
+	const Uint32* bottom_row = (const Uint32*)bottom;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i wy = _mm_set1_epi16((short)fy);
+	const __m128i wy_inverse = _mm_set1_epi16((short)(256 - fy));
+	for (int i = 0; i < count; i++, u += du) {
+		Sint64 left = u - BLIT_HALF;
+		int x = (int)(left >> 16);
+		short fx = (short)((left >> 8) & 0xff);
+		int x0 = SDL_clamp(x, 0, width - 1);
+		int x1 = SDL_clamp(x + 1, 0, width - 1);
+		__m128i t = _mm_unpacklo_epi8(_mm_set_epi32(0, 0, (int)top_row[x1], (int)top_row[x0]), zero);
+		__m128i b = _mm_unpacklo_epi8(_mm_set_epi32(0, 0, (int)bottom_row[x1], (int)bottom_row[x0]), zero);
+		__m128i columns = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(t, wy_inverse), _mm_mullo_epi16(b, wy)), 8);
+		short fx_inverse = (short)(256 - fx);
+		__m128i h = _mm_mullo_epi16(columns, _mm_set_epi16(fx, fx, fx, fx, fx_inverse, fx_inverse, fx_inverse, fx_inverse));
+		h = _mm_srli_epi16(_mm_add_epi16(h, _mm_srli_si128(h, 8)), 8);
+		out[i] = (Uint32)_mm_cvtsi128_si32(_mm_packus_epi16(h, zero));
+	}
+}
+
+// Four pixels per register, the unpacks work per 128 bit half so the lane layout is the SSE2 one twice
+BLIT_AVX2 static inline __m256i div255_avx2(__m256i x)
+{
+	x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+	return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+template <int blend>
+BLIT_AVX2 static inline __m256i blend_avx2(__m256i d, __m256i s, __m256i colour)
+{
+	s = div255_avx2(_mm256_mullo_epi16(s, colour));
+	if (blend == SDL_BLENDMODE_NONE) {
+		return s;
+	}
+	const __m256i alpha_lanes = _mm256_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0);
+	__m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	if (blend == SDL_BLENDMODE_ADD || blend == SDL_BLENDMODE_MOD) {
+		__m256i rgb = blend == SDL_BLENDMODE_ADD
+			? _mm256_min_epi16(_mm256_add_epi16(d, div255_avx2(_mm256_mullo_epi16(s, a))), _mm256_set1_epi16(255))
+			: div255_avx2(_mm256_mullo_epi16(s, d));
+		return _mm256_blendv_epi8(rgb, d, alpha_lanes);
+	}
+	s = _mm256_or_si256(s, _mm256_and_si256(alpha_lanes, _mm256_set1_epi16(255)));
+	__m256i inverse = _mm256_sub_epi16(_mm256_set1_epi16(255), a);
+	return div255_avx2(_mm256_add_epi16(_mm256_mullo_epi16(s, a), _mm256_mullo_epi16(d, inverse)));
+}
+
+template <int blend>
+BLIT_AVX2 static void blend_row_avx2(Uint32* dst, const Uint32* src, int count, const Uint8* colour)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i c = _mm256_set_epi16(
+		colour[3], colour[2], colour[1], colour[0], colour[3], colour[2], colour[1], colour[0],
+		colour[3], colour[2], colour[1], colour[0], colour[3], colour[2], colour[1], colour[0]);
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+		__m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+		__m256i lo = blend_avx2<blend>(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(s, zero), c);
+		__m256i hi = blend_avx2<blend>(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(s, zero), c);
+		_mm256_storeu_si256((__m256i*)(dst + i), _mm256_packus_epi16(lo, hi));
+	}
+	blend_row_sse2<blend>(dst + i, src + i, count - i, colour);
+}
+#endif
+
+static blit_simd detect_simd()
+{
+#ifdef BLIT_X86
+	if (SDL_HasAVX2()) {
+		return BLIT_SIMD_AVX2;
+	}
+	if (SDL_HasSSE2()) {
+		return BLIT_SIMD_SSE2;
+	}
+#endif
+	return BLIT_SIMD_SCALAR;
+}
+
+static blit_simd& best_simd()
+{
+	static blit_simd best = detect_simd();
+	return best;
+}
+
+static blit_simd& current_simd()
+{
+	static blit_simd current = best_simd();
+	return current;
+}
+
+template <int blend>
+static blend_row_function get_blend_row(blit_simd simd)
+{
+#ifdef BLIT_X86
+	if (simd == BLIT_SIMD_AVX2) {
+		return blend_row_avx2<blend>;
+	}
+	if (simd == BLIT_SIMD_SSE2) {
+		return blend_row_sse2<blend>;
+	}
+#endif
+	return blend_row_scalar<blend>;
+}
+
+static blend_row_function get_blend_row(blit_simd simd, SDL_BlendMode blend)
+{
+	switch (blend) {
+	case SDL_BLENDMODE_NONE: return get_blend_row<SDL_BLENDMODE_NONE>(simd);
+	case SDL_BLENDMODE_ADD: return get_blend_row<SDL_BLENDMODE_ADD>(simd);
+	case SDL_BLENDMODE_MOD: return get_blend_row<SDL_BLENDMODE_MOD>(simd);
+	default: return get_blend_row<SDL_BLENDMODE_BLEND>(simd);
+	}
+}
+
+static sample_row_function get_sample_row(blit_simd simd, blit_filter filter)
+{
+	if (filter == BLIT_FILTER_NEAREST) {
+		return sample_nearest;
+	}
+#ifdef BLIT_X86
+	// Bilinear takes a pixel at a time, AVX2 has nothing over SSE2 there
+	if (simd != BLIT_SIMD_SCALAR) {
+		return sample_bilinear_sse2;
+	}
+#endif
+	return sample_bilinear_scalar;
+}
+
+blit_simd software_blit::get_simd()
+{
+	return current_simd();
+}
+
+void software_blit::set_simd(blit_simd simd)
+{
+	current_simd() = SDL_min(simd, best_simd());
+}
+
+void software_blit::draw(SDL_Surface* target, const SDL_Rect& clip, const SDL_Surface* source, const SDL_Rect& src, const SDL_FRect& dst, SDL_Colour colour, SDL_BlendMode blend, blit_filter filter)
+{
+	if (target == nullptr || source == nullptr || src.w <= 0 || src.h <= 0 || dst.w <= 0.0f || dst.h <= 0.0f) {
+		return;
+	}
+	if (target->format->format != SDL_PIXELFORMAT_RGBA32 || source->format->format != SDL_PIXELFORMAT_RGBA32) {
+		return;
+	}
+
+	// Every pixel whose center is inside dst, first to end
+	int first_x = (int)SDL_ceilf(dst.x - 0.5f);
+	int first_y = (int)SDL_ceilf(dst.y - 0.5f);
+	int end_x = (int)SDL_ceilf(dst.x + dst.w - 0.5f);
+	int end_y = (int)SDL_ceilf(dst.y + dst.h - 0.5f);
+
+	SDL_Rect bounds{ 0, 0, target->w, target->h };
+	SDL_Rect area;
+	if (!SDL_IntersectRect(&bounds, &clip, &area)) {
+		return;
+	}
+	int x0 = SDL_max(first_x, area.x);
+	int y0 = SDL_max(first_y, area.y);
+	int x1 = SDL_min(end_x, area.x + area.w);
+	int y1 = SDL_min(end_y, area.y + area.h);
+	if (x0 >= x1 || y0 >= y1) {
+		return;
+	}
+
+	// Source position of the first covered pixel center, the clipped start is reached in whole steps from there
+	double scale_x = src.w / (double)dst.w;
+	double scale_y = src.h / (double)dst.h;
+	Sint64 du = (Sint64)(scale_x * BLIT_ONE);
+	Sint64 dv = (Sint64)(scale_y * BLIT_ONE);
+	Sint64 u = (Sint64)((first_x + 0.5 - dst.x) * scale_x * BLIT_ONE) + (x0 - first_x) * du;
+	Sint64 v_first = (Sint64)((first_y + 0.5 - dst.y) * scale_y * BLIT_ONE);
+
+	blit_simd simd = current_simd();
+	blend_row_function blend_row = get_blend_row(simd, blend);
+	sample_row_function sample_row = get_sample_row(simd, filter);
+	const Uint8 modulate[4]{ colour.r, colour.g, colour.b, colour.a };
+	int count = x1 - x0;
+	// Unscaled nearest rows are read straight from the source
+	int direct_x = (int)(u >> 16);
+	bool direct = filter == BLIT_FILTER_NEAREST && du == BLIT_ONE && direct_x >= 0 && direct_x + count <= src.w;
+	if (!direct && (int)sampled.size() < count) {
+		sampled.resize(count);
+	}
+
+	const Uint8* source_pixels = (const Uint8*)source->pixels + src.x * 4;
+	for (int y = y0; y < y1; y++) {
+		Sint64 v = v_first + (y - first_y) * dv;
+		Uint32* row = (Uint32*)((Uint8*)target->pixels + y * target->pitch) + x0;
+		if (filter == BLIT_FILTER_NEAREST) {
+			const Uint8* line = source_pixels + (src.y + SDL_clamp((int)(v >> 16), 0, src.h - 1)) * source->pitch;
+			if (direct) {
+				blend_row(row, (const Uint32*)line + direct_x, count, modulate);
+				continue;
+			}
+			sample_row(line, line, 0, src.w, u, du, sampled.data(), count);
+		}
+		else {
+			Sint64 top = v - BLIT_HALF;
+			int sy = (int)(top >> 16);
+			int fy = (int)((top >> 8) & 0xff);
+			const Uint8* top_line = source_pixels + (src.y + SDL_clamp(sy, 0, src.h - 1)) * source->pitch;
+			const Uint8* bottom_line = source_pixels + (src.y + SDL_clamp(sy + 1, 0, src.h - 1)) * source->pitch;
+			sample_row(top_line, bottom_line, fy, src.w, u, du, sampled.data(), count);
+		}
+		blend_row(row, sampled.data(), count, modulate);
+	}
+}
+
+void software_blit::add_pixels(SDL_Texture* texture, SDL_Surface* pixels)
+{
+	if (texture == nullptr || pixels == nullptr) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(pixels_mutex);
+	pixels_by_texture[texture] = pixels;
+}
+
+void software_blit::remove_pixels(SDL_Texture* texture)
+{
+	std::lock_guard<std::mutex> lock(pixels_mutex);
+	pixels_by_texture.erase(texture);
+}
+
+SDL_Surface* software_blit::find_pixels(SDL_Texture* texture)
+{
+	std::lock_guard<std::mutex> lock(pixels_mutex);
+	auto it = pixels_by_texture.find(texture);
+	return it != pixels_by_texture.end() ? it->second : nullptr;
+}
@@ -0,0 +1,133 @@
+#include "spatial_grid.h"
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+void spatial_grid::create(float size)
+{
+	cell_size = size;
+	inverse_cell_size = 1.0f / size;
+	clear();
+}
+
+void spatial_grid::clear()
+{
+	// Keep the cell vectors around, a scene reload fills the same cells again
+	for (auto& c : cells) {
+		c.second.clear();
+	}
+	entries.clear();
+	inserted_count = 0;
+	query_stamp = 0;
+}
+
+spatial_grid::cell_range spatial_grid::get_cells(const SDL_FRect& bounds) const
+{
+	return {
+		(int)floorf(bounds.x * inverse_cell_size),
+		(int)floorf(bounds.y * inverse_cell_size),
+		(int)floorf((bounds.x + bounds.w) * inverse_cell_size),
+		(int)floorf((bounds.y + bounds.h) * inverse_cell_size)
+	};
+}
+
+long long spatial_grid::get_key(int x, int y)
+{
+	return ((long long)x << 32) | (unsigned int)y;
+}
+
+void spatial_grid::insert_cells(size_t id, const cell_range& range)
+{
+	for (int y = range.min_y; y <= range.max_y; y++) {
+		for (int x = range.min_x; x <= range.max_x; x++) {
+			cells[get_key(x, y)].push_back(id);
+		}
+	}
+}
+
+void spatial_grid::remove_cells(size_t id, const cell_range& range)
+{
+	for (int y = range.min_y; y <= range.max_y; y++) {
+		for (int x = range.min_x; x <= range.max_x; x++) {
+			auto it = cells.find(get_key(x, y));
+			if (it == cells.end()) {
+				continue;
+			}
+			std::vector<size_t>& ids = it->second;
+			auto found = std::find(ids.begin(), ids.end(), id);
+			if (found != ids.end()) {
+				*found = ids.back();
+				ids.pop_back();
+			}
+		}
+	}
+}
+
+void spatial_grid::update(size_t id, const SDL_FRect& bounds)
+{
+	if (id >= entries.size()) {
+		entries.resize(id + 1, { false, { 0, 0, 0, 0 }, { 0, 0, -1, -1 }, 0 });
+	}
+	entry& e = entries[id];
+	cell_range range = get_cells(bounds);
+	e.bounds = bounds;
+	if (e.inserted && memcmp(&range, &e.cells, sizeof(range)) == 0) {
+		return;
+	}
+	if (e.inserted) {
+		remove_cells(id, e.cells);
+	}
+	else {
+		inserted_count += 1;
+	}
+	insert_cells(id, range);
+	e.cells = range;
+	e.inserted = true;
+}
+
+void spatial_grid::remove(size_t id)
+{
+	if (id >= entries.size() || !entries[id].inserted) {
+		return;
+	}
+	remove_cells(id, entries[id].cells);
+	entries[id].inserted = false;
+	inserted_count -= 1;
+}
+
+size_t spatial_grid::query(const SDL_FRect& area, size_t* out)
+{
+	// Stamps stop ids spanning several cells from being added more than once
+	query_stamp += 1;
+	size_t count{ 0 };
+	cell_range range = get_cells(area);
+	for (int y = range.min_y; y <= range.max_y; y++) {
+		for (int x = range.min_x; x <= range.max_x; x++) {
+			auto it = cells.find(get_key(x, y));
+			if (it == cells.end()) {
+				continue;
+			}
+			for (size_t id : it->second) {
+				entry& e = entries[id];
+				if (e.query_stamp == query_stamp) {
+					continue;
+				}
+				e.query_stamp = query_stamp;
+				// Touching a cell is not overlapping, the bounds decide
+				if (e.bounds.x <= area.x + area.w && e.bounds.x + e.bounds.w >= area.x
+					&& e.bounds.y <= area.y + area.h && e.bounds.y + e.bounds.h >= area.y) {
+					out[count] = id;
+					count += 1;
+				}
+			}
+		}
+	}
+	std::sort(out, out + count);
+	return count;
+}
+
+size_t spatial_grid::get_count() const
+{
+	return inserted_count;
+}
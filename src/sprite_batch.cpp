@@ -0,0 +1,105 @@
+#include "sprite_batch.h"
+
+#include <algorithm>
+
+// Every quad uses the same 0 1 2, 2 3 0 pattern, so all buckets share one index buffer
+static std::vector<int> indices;
+
+static void ensure_indices(size_t quad_count)
+{
+	size_t existing = indices.size() / 6;
+	if (existing >= quad_count) {
+		return;
+	}
+	indices.reserve(quad_count * 6);
+	for (size_t i = existing; i < quad_count; i++) {
+		int base = (int)(i * 4);
+		indices.push_back(base + 0);
+		indices.push_back(base + 1);
+		indices.push_back(base + 2);
+		indices.push_back(base + 2);
+		indices.push_back(base + 3);
+		indices.push_back(base + 0);
+	}
+}
+
+void sprite_batch::add(SDL_Texture* texture, const SDL_Rect& src, const SDL_FRect& dst, SDL_Colour colour)
+{
+	if (texture == nullptr) {
+		return;
+	}
+
+	bucket* target = nullptr;
+	for (auto& b : buckets) {
+		if (b.texture == texture) {
+			target = &b;
+			break;
+		}
+	}
+	if (target == nullptr) {
+		// Reuse a bucket that went empty before growing the list
+		for (auto& b : buckets) {
+			if (b.vertices.empty()) {
+				target = &b;
+				target->texture = texture;
+				break;
+			}
+		}
+		if (target == nullptr) {
+			buckets.push_back({ texture, { 0, 0 }, 0, {} });
+			target = &buckets.back();
+		}
+	}
+	if (target->vertices.empty()) {
+		// Query on first use each flush, the texture behind a pointer might have been swapped out
+		int width;
+		int height;
+		SDL_QueryTexture(texture, nullptr, nullptr, &width, &height);
+		target->inverse_size = { 1.0f / width, 1.0f / height };
+		target->first_use = used_buckets;
+		used_buckets += 1;
+	}
+
+	float u0 = src.x * target->inverse_size.x;
+	float v0 = src.y * target->inverse_size.y;
+	float u1 = (src.x + src.w) * target->inverse_size.x;
+	float v1 = (src.y + src.h) * target->inverse_size.y;
+
+	target->vertices.push_back({ { dst.x, dst.y }, colour, { u0, v0 } });
+	target->vertices.push_back({ { dst.x + dst.w, dst.y }, colour, { u1, v0 } });
+	target->vertices.push_back({ { dst.x + dst.w, dst.y + dst.h }, colour, { u1, v1 } });
+	target->vertices.push_back({ { dst.x, dst.y + dst.h }, colour, { u0, v1 } });
+	quads += 1;
+}
+
+void sprite_batch::flush(SDL_Renderer* renderer)
+{
+	if (quads == 0) {
+		return;
+	}
+	ensure_indices(quads);
+
+	// Only a handful of textures, so ordering by first use is just a few swaps
+	std::sort(buckets.begin(), buckets.end(), [](const bucket& lhs, const bucket& rhs) {
+		if (lhs.vertices.empty() != rhs.vertices.empty()) {
+			return !lhs.vertices.empty();
+		}
+		return lhs.first_use < rhs.first_use;
+	});
+
+	for (auto& b : buckets) {
+		if (b.vertices.empty()) {
+			break;
+		}
+		int quad_count = (int)(b.vertices.size() / 4);
+		SDL_RenderGeometry(renderer, b.texture, b.vertices.data(), (int)b.vertices.size(), indices.data(), quad_count * 6);
+		b.vertices.clear();
+	}
+	used_buckets = 0;
+	quads = 0;
+}
+
+bool sprite_batch::is_empty() const
+{
+	return quads == 0;
+}
@@ -0,0 +1,94 @@
+#include "startup_timer.h"
+
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <SDL/SDL.h>
+
+static std::mutex mutex;
+static std::vector<startup_timer::phase> phases;
+static unsigned long long begun{ 0 };
+static unsigned long long finished_at{ 0 };
+static bool finished{ false };
+
+static double to_ms(unsigned long long ticks)
+{
+	return (double)ticks * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+void startup_timer::begin()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	phases.clear();
+	begun = now();
+	finished_at = 0;
+	finished = false;
+}
+
+void startup_timer::record(const char* name, unsigned long long start)
+{
+	unsigned long long end = now();
+	std::lock_guard<std::mutex> lock(mutex);
+	// Loads after startup are not part of it
+	if (finished) {
+		return;
+	}
+	double start_ms = to_ms(start - begun);
+	double end_ms = to_ms(end - begun);
+	for (auto& p : phases) {
+		if (strcmp(p.name, name) == 0) {
+			p.start_ms = SDL_min(p.start_ms, start_ms);
+			p.end_ms = SDL_max(p.end_ms, end_ms);
+			p.total_ms += end_ms - start_ms;
+			p.count += 1;
+			return;
+		}
+	}
+	phases.push_back({ name, start_ms, end_ms, end_ms - start_ms, 1 });
+}
+
+void startup_timer::finish()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (finished) {
+			return;
+		}
+		finished = true;
+		finished_at = now();
+	}
+	print();
+}
+
+bool startup_timer::is_finished()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return finished;
+}
+
+unsigned long long startup_timer::now()
+{
+	return SDL_GetPerformanceCounter();
+}
+
+std::vector<startup_timer::phase> startup_timer::get_phases()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return phases;
+}
+
+double startup_timer::get_total_ms()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return to_ms((finished ? finished_at : now()) - begun);
+}
+
+void startup_timer::print()
+{
+	std::vector<phase> copy = get_phases();
+	printf("%-16s %10s %10s %10s %6s\n", "startup", "from ms", "to ms", "total ms", "count");
+	for (const phase& p : copy) {
+		printf("%-16s %10.3f %10.3f %10.3f %6zu\n", p.name, p.start_ms, p.end_ms, p.total_ms, p.count);
+	}
+	printf("%-16s %10.3f %10.3f\n", "startup", 0.0, get_total_ms());
+}
@@ -0,0 +1,148 @@
+#include "tilemap.h"
+
+#include <math.h>
+#include <SDL/SDL.h>
+#include "arena.h"
+#include "render_thread.h"
+
+static const SDL_Point empty_tile{ -1, -1 };
+
+void tilemap::create(int map_columns, int map_rows, const SDL_FPoint& map_tile_size, const SDL_FPoint& map_origin, arena& memory)
+{
+	destroy();
+	int map_chunk_columns = (map_columns + chunk_tiles - 1) / chunk_tiles;
+	int map_chunk_rows = (map_rows + chunk_tiles - 1) / chunk_tiles;
+	tiles = memory.allocate_array<SDL_Point>(map_columns * map_rows);
+	chunks = memory.allocate_array<chunk>(map_chunk_columns * map_chunk_rows);
+	if (tiles == nullptr || chunks == nullptr) {
+		// Out of memory, stays an empty map
+		tiles = nullptr;
+		chunks = nullptr;
+		return;
+	}
+	columns = map_columns;
+	rows = map_rows;
+	tile_size = map_tile_size;
+	origin = map_origin;
+	chunk_columns = map_chunk_columns;
+	chunk_rows = map_chunk_rows;
+	for (int i = 0; i < columns * rows; i++) {
+		tiles[i] = empty_tile;
+	}
+	for (int i = 0; i < chunk_columns * chunk_rows; i++) {
+		chunks[i] = { nullptr, false, 0 };
+	}
+}
+
+void tilemap::destroy()
+{
+	// The frame in flight might still draw the chunks
+	render_thread::wait_idle();
+	render_thread::call([this]() {
+		for (int i = 0; i < chunk_columns * chunk_rows; i++) {
+			SDL_DestroyTexture(chunks[i].texture);
+		}
+	});
+	// The memory itself goes when its arena is reset
+	tiles = nullptr;
+	chunks = nullptr;
+	columns = 0;
+	rows = 0;
+	chunk_columns = 0;
+	chunk_rows = 0;
+}
+
+bool tilemap::is_inside(int column, int row) const
+{
+	return column >= 0 && row >= 0 && column < columns && row < rows;
+}
+
+void tilemap::set(int column, int row, const SDL_Point& sprite_index)
+{
+	if (!is_inside(column, row)) {
+		return;
+	}
+	SDL_Point& tile = tiles[row * columns + column];
+	bool was_empty = tile.x < 0 || tile.y < 0;
+	bool is_cleared = sprite_index.x < 0 || sprite_index.y < 0;
+	if (tile.x == sprite_index.x && tile.y == sprite_index.y) {
+		return;
+	}
+	tile = is_cleared ? empty_tile : sprite_index;
+
+	chunk& c = get_chunk(column / chunk_tiles, row / chunk_tiles);
+	c.used_tiles += (was_empty ? 1 : 0) - (is_cleared ? 1 : 0);
+	c.dirty = true;
+}
+
+SDL_Point tilemap::get(int column, int row) const
+{
+	if (!is_inside(column, row)) {
+		return empty_tile;
+	}
+	return tiles[row * columns + column];
+}
+
+bool tilemap::is_empty(int column, int row) const
+{
+	SDL_Point tile = get(column, row);
+	return tile.x < 0 || tile.y < 0;
+}
+
+bool tilemap::to_cell(const SDL_FPoint& world, SDL_Point& out_cell) const
+{
+	out_cell = { (int)floorf((world.x - origin.x) / tile_size.x), (int)floorf((world.y - origin.y) / tile_size.y) };
+	return is_inside(out_cell.x, out_cell.y);
+}
+
+void tilemap::invalidate()
+{
+	for (int i = 0; i < chunk_columns * chunk_rows; i++) {
+		chunks[i].dirty = true;
+	}
+}
+
+int tilemap::get_columns() const
+{
+	return columns;
+}
+
+int tilemap::get_rows() const
+{
+	return rows;
+}
+
+int tilemap::get_chunk_columns() const
+{
+	return chunk_columns;
+}
+
+int tilemap::get_chunk_rows() const
+{
+	return chunk_rows;
+}
+
+tilemap::chunk& tilemap::get_chunk(int chunk_column, int chunk_row)
+{
+	return chunks[chunk_row * chunk_columns + chunk_column];
+}
+
+SDL_FRect tilemap::get_chunk_bounds(int chunk_column, int chunk_row) const
+{
+	return {
+		origin.x + chunk_column * chunk_tiles * tile_size.x,
+		origin.y + chunk_row * chunk_tiles * tile_size.y,
+		chunk_tiles * tile_size.x,
+		chunk_tiles * tile_size.y
+	};
+}
+
+SDL_FRect tilemap::get_bounds() const
+{
+	return { origin.x, origin.y, columns * tile_size.x, rows * tile_size.y };
+}
+
+SDL_FPoint tilemap::get_tile_size() const
+{
+	return tile_size;
+}
@@ -0,0 +1,120 @@
+// Packs images and fonts into one asset pack the engine maps at startup instead of decoding the loose files
+// Build & run (Linux):
+//	g++ -std=c++20 -O2 -Iinclude tools/asset_packer.cpp src/sdf_font.cpp -lSDL2 -lSDL2_image -lSDL2_ttf -o asset_packer
+//	./asset_packer res/assets.pack res/objects.png res/rock_packed.png res/roboto.ttf
+// Names are the paths exactly as given, run it from where the game runs so they match what the engine loads
+// Images are stored as RGBA32, .ttf files are baked into the same distance field fonts the engine bakes
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <SDL/SDL.h>
+#include <SDL/SDL_image.h>
+#include <SDL/SDL_ttf.h>
+
+#include "asset_pack.h"
+#include "sdf_font.h"
+
+static bool ends_with(const std::string& text, const char* suffix)
+{
+	size_t length = strlen(suffix);
+	return text.size() >= length && SDL_strcasecmp(text.c_str() + text.size() - length, suffix) == 0;
+}
+
+static void pad(std::vector<unsigned char>& pack, size_t alignment)
+{
+	pack.resize((pack.size() + alignment - 1) / alignment * alignment, 0);
+}
+
+static bool pack_image(const char* path, asset_pack_entry& entry, std::vector<unsigned char>& pack)
+{
+	SDL_Surface* loaded = IMG_Load(path);
+	SDL_Surface* pixels = loaded != nullptr ? SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0) : nullptr;
+	SDL_FreeSurface(loaded);
+	if (pixels == nullptr) {
+		printf("Could not load %s: %s\n", path, IMG_GetError());
+		return false;
+	}
+	// Rows are stored tightly, the pitch is there so the format can change that later
+	entry.type = ASSET_PACK_IMAGE;
+	entry.format = SDL_PIXELFORMAT_RGBA32;
+	entry.width = pixels->w;
+	entry.height = pixels->h;
+	entry.pitch = pixels->w * 4;
+	entry.size = (Uint64)entry.pitch * entry.height;
+	for (int y = 0; y < pixels->h; y++) {
+		const unsigned char* row = (const unsigned char*)pixels->pixels + y * pixels->pitch;
+		pack.insert(pack.end(), row, row + entry.pitch);
+	}
+	SDL_FreeSurface(pixels);
+	return true;
+}
+
+static bool pack_font(const char* path, asset_pack_entry& entry, std::vector<unsigned char>& pack)
+{
+	sdf_font font;
+	std::vector<unsigned char> cache;
+	if (!font.bake(path) || !font.write_cache(cache)) {
+		printf("Could not bake %s\n", path);
+		return false;
+	}
+	entry.type = ASSET_PACK_FONT;
+	entry.size = cache.size();
+	pack.insert(pack.end(), cache.begin(), cache.end());
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3) {
+		printf("Usage: %s <output pack> <image or ttf>...\n", argv[0]);
+		return 1;
+	}
+	SDL_Init(0);
+	IMG_Init(IMG_INIT_JPG | IMG_INIT_PNG);
+	TTF_Init();
+
+	std::vector<unsigned char> pack(sizeof(asset_pack_header), 0);
+	std::vector<asset_pack_entry> toc;
+	bool failed = false;
+	for (int i = 2; i < argc; i++) {
+		std::string name = argv[i];
+		if (name.size() >= ASSET_PACK_NAME_SIZE) {
+			printf("Name too long for the pack: %s\n", argv[i]);
+			failed = true;
+			continue;
+		}
+		asset_pack_entry entry{};
+		memcpy(entry.name, name.c_str(), name.size() + 1);
+		pad(pack, ASSET_PACK_ALIGNMENT);
+		entry.offset = pack.size();
+		bool packed = ends_with(name, ".ttf") ? pack_font(argv[i], entry, pack) : pack_image(argv[i], entry, pack);
+		if (!packed) {
+			failed = true;
+			continue;
+		}
+		toc.push_back(entry);
+		printf("%-40s %10llu bytes\n", entry.name, (unsigned long long)entry.size);
+	}
+
+	pad(pack, ASSET_PACK_ALIGNMENT);
+	asset_pack_header header{ ASSET_PACK_MAGIC, ASSET_PACK_VERSION, (Uint32)toc.size(), 0, pack.size() };
+	memcpy(pack.data(), &header, sizeof(header));
+	const unsigned char* toc_bytes = (const unsigned char*)toc.data();
+	pack.insert(pack.end(), toc_bytes, toc_bytes + toc.size() * sizeof(asset_pack_entry));
+
+	FILE* file = fopen(argv[1], "wb");
+	bool written = file != nullptr && fwrite(pack.data(), 1, pack.size(), file) == pack.size();
+	if (file != nullptr) {
+		fclose(file);
+	}
+	TTF_Quit();
+	IMG_Quit();
+	SDL_Quit();
+	if (!written) {
+		printf("Could not write %s\n", argv[1]);
+		return 1;
+	}
+	printf("%zu assets, %zu bytes written to %s\n", toc.size(), pack.size(), argv[1]);
+	return failed ? 1 : 0;
+}